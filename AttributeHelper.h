@@ -13,39 +13,206 @@
 #include "FMDataSerialize.h"
 #include "Modeler/FMMdlIterators.h"
 
+#include "Log.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 class AttributeHelper
 {
 public:
 
-    static double getDouble(OdIfc::OdIfcInstancePtr inst, const char* attr) {
+    // Instances of an aggregate attribute. Only the ids are held, an instance is opened when it is dereferenced
+    class InstanceRange
+    {
+    public:
+        class iterator
+        {
+        public:
+            explicit iterator(const OdDAIObjectId* id) : mId(id) {}
+
+            OdIfc::OdIfcInstancePtr operator*() const { return mId->openObject(); }
+            iterator& operator++() { ++mId; return *this; }
+            bool operator==(const iterator& rhs) const { return mId == rhs.mId; }
+            bool operator!=(const iterator& rhs) const { return mId != rhs.mId; }
+
+        private:
+            const OdDAIObjectId* mId;
+        };
+
+        InstanceRange() = default;
+        explicit InstanceRange(const OdArray<OdDAIObjectId>& ids) : mIds(ids) {}
+
+        std::size_t size() const { return mIds.size(); }
+        bool empty() const { return mIds.isEmpty(); }
+
+        const OdDAIObjectId& id(std::size_t i) const { return mIds[(unsigned int)i]; }
+        OdIfc::OdIfcInstancePtr operator[](std::size_t i) const { return id(i).openObject(); }
+
+        iterator begin() const { return iterator(mIds.begin()); }
+        iterator end() const { return iterator(mIds.end()); }
+
+    private:
+        OdArray<OdDAIObjectId> mIds;    // shares the buffer of an entity aggregate, nothing is copied
+    };
+
+    struct CacheStats
+    {
+        OdUInt64 hits;
+        OdUInt64 misses;
+    };
+
+    // Resolves an attribute name to its descriptor, once per name and thread.
+    // The descriptor is the same for every entity type that has the attribute, the cache is keyed by the characters
+    // of the name. The attributes read per point, loop and face are resolved once into function-local descriptors
+    // and don't go through the cache. Hits and misses are only counted while the profiler is enabled
+    static OdIfc::OdIfcAttribute attributeKey(const char* attr) {
+        AttributeCache& cache = attributeCache();
+        auto it = cache.attributes.find(attr);
+        if (it != cache.attributes.end()) {
+            if (Profiler::isEnabled()) {
+                cacheCounter(true).fetch_add(1, std::memory_order_relaxed);
+            }
+            return it->second;
+        }
+        if (Profiler::isEnabled()) {
+            cacheCounter(false).fetch_add(1, std::memory_order_relaxed);
+        }
+        OdIfc::OdIfcAttribute attribute = OdIfc::Utils::stringToAttribute(attr);
+        cache.names.emplace_back(attr);
+        cache.attributes.emplace(cache.names.back().c_str(), attribute);
+        return attribute;
+    }
+
+    // Counted while the profiler is enabled only
+    static CacheStats cacheStats() {
+        return{ cacheCounter(true).load(), cacheCounter(false).load() };
+    }
+
+    static OdRxValue getAttr(OdIfc::OdIfcInstance* inst, const char* attr) {
+        return inst->getAttr(attributeKey(attr));
+    }
+
+    static OdRxValue getAttr(OdIfc::OdIfcInstance* inst, OdIfc::OdIfcAttribute attr) {
+        return inst->getAttr(attr);
+    }
+
+    template<typename A>
+    static double getDouble(OdIfc::OdIfcInstancePtr inst, A attr) {
         double ret;
-        OdRxValue val = inst->getAttr(attr);
+        OdRxValue val = getAttr(inst, attr);
         val >> ret;
         return ret;
     }
 
-    template<typename T>
-    static T getVector(OdIfc::OdIfcInstancePtr coord, const char* componentsName) {
+    template<typename A>
+    static double getOptionalDouble(OdIfc::OdIfcInstancePtr inst, A attr, double defaultValue) {
+        double ret;
+        OdRxValue val = getAttr(inst, attr);
+        if (val.isEmpty() || !(val >> ret) || OdDAI::Utils::isUnset(ret)) {
+            return defaultValue;
+        }
+        return ret;
+    }
+
+    template<typename T, typename A>
+    static T getVector(OdIfc::OdIfcInstancePtr coord, A componentsName) {
         T ret;
-        OdRxValue components = coord->getAttr(componentsName);
+        readCoordinates(coord, componentsName, &ret[0], sizeof(T) / sizeof(double));
+        return ret;
+    }
+
+    // IfcCartesianPoint.coordinates, read in place from the aggregate without iterator or boxed values
+    static OdGePoint3d getPoint3d(OdIfc::OdIfcInstance* point) {
+        static const OdIfc::OdIfcAttribute kCoordinates = attributeKey("coordinates");
+        OdGePoint3d ret;
+        readCoordinates(point, kCoordinates, &ret.x, 3);
+        return ret;
+    }
+
+    // IfcDirection.directionratios, read in place from the aggregate without iterator or boxed values
+    static OdGeVector3d getDirection3d(OdIfc::OdIfcInstance* direction) {
+        static const OdIfc::OdIfcAttribute kDirectionRatios = attributeKey("directionratios");
+        OdGeVector3d ret;
+        readCoordinates(direction, kDirectionRatios, &ret.x, 3);
+        return ret;
+    }
+
+    // Appends the IfcCartesianPoints of an IfcPolyLoop.polygon to points, points that can't be opened are skipped
+    template<typename Points>
+    static void getPolygonPoints(OdIfc::OdIfcInstance* polyLoop, Points& points) {
+        static const OdIfc::OdIfcAttribute kPolygon = attributeKey("polygon");
         OdDAI::Aggr* aggr = NULL;
-        components >> aggr;
+        if (!(getAttr(polyLoop, kPolygon) >> aggr) || aggr == NULL || aggr->isNil()) {
+            return;
+        }
+        const OdArray<OdDAIObjectId>& pointIds = aggr->getArray<OdDAIObjectId>();
+        points.reserve(points.size() + pointIds.size());
+        for (const OdDAIObjectId& pointId : pointIds)
+        {
+            OdIfc::OdIfcInstancePtr point = pointId.openObject();
+            if (point.isNull()) {
+                BREP_LOG(Warning, "IfcPolyLoop #" << (OdUInt64)polyLoop->id().getHandle() << " has a null point, it is skipped.");
+                continue;
+            }
+            points.push_back(getPoint3d(point));
+        }
+    }
+
+    // Appends the 2D IfcCartesianPoints of a list attribute (IfcPolyline.points) to points, points that can't be opened
+    // are skipped
+    template<typename A>
+    static void getPoints2d(OdIfc::OdIfcInstance* inst, A attr, std::vector<OdGePoint2d>& points) {
+        OdDAI::Aggr* aggr = NULL;
+        if (!(getAttr(inst, attr) >> aggr) || aggr == NULL || aggr->isNil()) {
+            return;
+        }
+        const OdArray<OdDAIObjectId>& pointIds = aggr->getArray<OdDAIObjectId>();
+        points.reserve(points.size() + pointIds.size());
+        for (const OdDAIObjectId& pointId : pointIds)
+        {
+            OdIfc::OdIfcInstancePtr point = pointId.openObject();
+            if (point.isNull()) {
+                BREP_LOG(Warning, "#" << (OdUInt64)inst->id().getHandle() << " has a null point, it is skipped.");
+                continue;
+            }
+            static const OdIfc::OdIfcAttribute kCoordinates = attributeKey("coordinates");
+            OdGePoint2d pt;
+            readCoordinates(point.get(), kCoordinates, &pt.x, 2);
+            points.push_back(pt);
+        }
+    }
+
+    // Appends the coordinates of an IfcCartesianPointList2D.coordlist (LIST OF LIST OF REAL) to points
+    static void getPointList2d(OdIfc::OdIfcInstance* pointList, std::vector<OdGePoint2d>& points) {
+        OdDAI::Aggr* aggr = NULL;
+        if (!(getAttr(pointList, "coordlist") >> aggr) || aggr == NULL || aggr->isNil()) {
+            return;
+        }
         OdDAI::IteratorPtr iterator = aggr->createIterator();
-        int i = 0;
-        for (iterator->beginning(); iterator->next(); i++)
+        for (iterator->beginning(); iterator->next();)
         {
-            OdRxValue val = iterator->getCurrentMember();
-            double coord;
-            val >> coord;
-            ret[i] = coord;
+            OdGePoint2d pt;
+            OdDAI::Aggr* coordinates = NULL;
+            if ((iterator->getCurrentMember() >> coordinates) && coordinates != NULL && !coordinates->isNil()) {
+                const OdArray<double>& components = coordinates->getArray<double>();
+                pt.x = components.size() > 0 ? components[0] : 0.0;
+                pt.y = components.size() > 1 ? components[1] : 0.0;
+            }
+            points.push_back(pt);
         }
-        return ret;
     }
 
-    template<typename T>
-    static T getVector(OdIfc::OdIfcInstancePtr pInst, const char* attrName, const char* componentsName) {
+    template<typename T, typename A, typename C>
+    static T getVector(OdIfc::OdIfcInstancePtr pInst, A attrName, C componentsName) {
         OdDAIObjectId retId;
-        OdRxValue extrudedDirectionVal = pInst->getAttr(attrName);
+        OdRxValue extrudedDirectionVal = getAttr(pInst, attrName);
         if (extrudedDirectionVal.isEmpty()) {
             //std::cerr << std::format("Can't find {}", attrName).c_str() << std::endl;
             return{};
@@ -62,31 +229,101 @@ public:
         return getVector<T>(direction, componentsName);
     }
 
-    static OdIfc::OdIfcInstancePtr getAttributeAsInstance(OdIfc::OdIfcInstance* inst, const char* attr)
+    template<typename A>
+    static OdIfc::OdIfcInstancePtr getAttributeAsInstance(OdIfc::OdIfcInstance* inst, A attr)
     {
-        OdRxValue val = inst->getAttr(attr);
+        OdRxValue val = getAttr(inst, attr);
         OdDAIObjectId id;
         val >> id;
         return id.openObject();
     }
 
-    static std::vector<OdIfc::OdIfcInstancePtr> getAttributeAsInstanceVector(OdIfc::OdIfcInstance* inst, const char* attr)
+    // Empty if the attribute is unset. The members must be entity references, they are read in place; an aggregate
+    // of a SELECT type (IfcShellBasedSurfaceModel.sbsmboundary) stores select values, use getSelectAttributeAsInstanceRange
+    template<typename A>
+    static InstanceRange getAttributeAsInstanceRange(OdIfc::OdIfcInstance* inst, A attr)
     {
-        std::vector<OdIfc::OdIfcInstancePtr> ret;
-        OdRxValue components = inst->getAttr(attr);
         OdDAI::Aggr* aggr = NULL;
-        components >> aggr;
+        if (!(getAttr(inst, attr) >> aggr) || aggr == NULL || aggr->isNil()) {
+            return InstanceRange();
+        }
+        return InstanceRange(aggr->getArray<OdDAIObjectId>());
+    }
+
+    // Empty if the attribute is unset. The select values of the aggregate are converted to ids through its iterator,
+    // members that don't select an instance are skipped
+    template<typename A>
+    static InstanceRange getSelectAttributeAsInstanceRange(OdIfc::OdIfcInstance* inst, A attr)
+    {
+        OdDAI::Aggr* aggr = NULL;
+        if (!(getAttr(inst, attr) >> aggr) || aggr == NULL || aggr->isNil()) {
+            return InstanceRange();
+        }
+        OdArray<OdDAIObjectId> ids;
+        ids.reserve(aggr->getMemberCount());
         OdDAI::IteratorPtr iterator = aggr->createIterator();
-        int i = 0;
-        for (iterator->beginning(); iterator->next(); i++)
+        for (iterator->beginning(); iterator->next();)
         {
-            OdRxValue val = iterator->getCurrentMember();
             OdDAIObjectId id;
-            val >> id;
-            ret.push_back(id.openObject());
+            if ((iterator->getCurrentMember() >> id) && !id.isNull()) {
+                ids.push_back(id);
+            }
+        }
+        return InstanceRange(ids);
+    }
+
+private:
+
+    // Copies at most maxCount doubles of a LIST OF REAL attribute, missing components keep their value
+    template<typename A>
+    static void readCoordinates(OdIfc::OdIfcInstance* inst, A componentsName, double* ret, std::size_t maxCount) {
+        OdDAI::Aggr* aggr = NULL;
+        if (!(getAttr(inst, componentsName) >> aggr) || aggr == NULL || aggr->isNil()) {
+            return;
+        }
+        const OdArray<double>& components = aggr->getArray<double>();
+        const std::size_t count = std::min<std::size_t>(components.size(), maxCount);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ret[i] = components[(unsigned int)i];
         }
-        return ret;
     }
 
+    struct AttributeNameHash
+    {
+        std::size_t operator()(const char* name) const {
+            std::size_t hash = 2166136261u;
+            for (; *name != '\0'; ++name) {
+                hash = (hash ^ static_cast<unsigned char>(*name)) * 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    struct AttributeNameEqual
+    {
+        bool operator()(const char* lhs, const char* rhs) const {
+            return std::strcmp(lhs, rhs) == 0;
+        }
+    };
+
+    // The keys point into names, a deque doesn't move its strings when it grows
+    struct AttributeCache
+    {
+        std::unordered_map<const char*, OdIfc::OdIfcAttribute, AttributeNameHash, AttributeNameEqual> attributes;
+        std::deque<std::string> names;
+    };
+
+    // One cache per thread, the parallel conversion doesn't need to lock it
+    static AttributeCache& attributeCache() {
+        thread_local AttributeCache cache;
+        return cache;
+    }
+
+    static std::atomic<OdUInt64>& cacheCounter(bool hit) {
+        static std::atomic<OdUInt64> hits(0);
+        static std::atomic<OdUInt64> misses(0);
+        return hit ? hits : misses;
+    }
 };
 
@@ -0,0 +1,215 @@
+#include "BatchConverter.h"
+#include "BrepJsonWriter.h"
+#include "Log.h"
+
+#include "StaticRxObject.h"
+#include "RxDynamicModule.h"
+#include "RxThreadPoolService.h"
+#include "ThreadsCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+    std::string trim(const std::string& str)
+    {
+        const std::size_t first = str.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos)
+        {
+            return std::string();
+        }
+        const std::size_t last = str.find_last_not_of(" \t\r\n");
+        return str.substr(first, last - first + 1);
+    }
+
+    void convertJob(const BatchConverter::Job& job, BatchConverter::Result& result, const BatchConverter::ConvertFunction& convert)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        try
+        {
+            convert(job, result);
+            result.ok = true;
+        }
+        catch (const OdError& e)
+        {
+            result.error = (const char*)OdAnsiString(e.description());
+        }
+        catch (const std::exception& e)
+        {
+            result.error = e.what();
+        }
+        result.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (result.ok)
+        {
+            BREP_LOG(Info, job.input << " -> " << job.output << ": " << result.productCount << " products, " << result.totalSeconds << " s");
+        }
+        else
+        {
+            BREP_LOG(Error, job.input << ": " << result.error);
+        }
+    }
+
+    class FileConversionTask : public OdApcAtom
+    {
+    public:
+        void init(const std::vector<BatchConverter::Job>* pJobs, std::vector<BatchConverter::Result>* pResults,
+            std::atomic<std::size_t>* pNextJobIdx, const BatchConverter::ConvertFunction* pConvert)
+        {
+            mJobs = pJobs;
+            mResults = pResults;
+            mNextJobIdx = pNextJobIdx;
+            mConvert = pConvert;
+        }
+
+        void apcEntryPoint(OdApcParamType /*parameter*/) override
+        {
+            // One file at a time, the next one is only taken once the previous database is released
+            for (;;)
+            {
+                const std::size_t jobIdx = mNextJobIdx->fetch_add(1);
+                if (jobIdx >= mJobs->size())
+                {
+                    break;
+                }
+                convertJob((*mJobs)[jobIdx], (*mResults)[jobIdx], *mConvert);
+            }
+        }
+
+    private:
+        const std::vector<BatchConverter::Job>* mJobs = nullptr;
+        std::vector<BatchConverter::Result>* mResults = nullptr;
+        std::atomic<std::size_t>* mNextJobIdx = nullptr;
+        const BatchConverter::ConvertFunction* mConvert = nullptr;
+    };
+}
+
+BatchConverter::BatchConverter(unsigned int nWorkers)
+    : mWorkers(nWorkers)
+{
+}
+
+bool BatchConverter::readManifest(const std::string& manifestFilename, std::vector<Job>& jobs)
+{
+    std::ifstream manifestStream(manifestFilename.c_str(), std::ifstream::in);
+    if (!manifestStream)
+    {
+        return false;
+    }
+
+    std::string line;
+    bool bFirstLine = true;
+    while (std::getline(manifestStream, line))
+    {
+        // Editors on Windows save UTF-8 with a byte order mark
+        if (bFirstLine && line.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        {
+            line.erase(0, 3);
+        }
+        bFirstLine = false;
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::size_t separator = line.find('\t');
+        if (separator == std::string::npos)
+        {
+            separator = line.find(' ');
+        }
+        if (separator == std::string::npos)
+        {
+            BREP_LOG(Warning, "Manifest line without output filename: " << line);
+            continue;
+        }
+        jobs.push_back({ trim(line.substr(0, separator)), trim(line.substr(separator + 1)) });
+    }
+    return true;
+}
+
+void BatchConverter::run(const std::vector<Job>& jobs, const ConvertFunction& convert)
+{
+    mResults.assign(jobs.size(), Result());
+
+    OdRxThreadPoolServicePtr pThreadPool = odrxDynamicLinker()->loadApp(OdThreadPoolModuleName);
+    unsigned int nWorkers = mWorkers;
+    if (!pThreadPool.isNull() && nWorkers == 0)
+    {
+        nWorkers = pThreadPool->numCPUs();
+    }
+    nWorkers = (unsigned int)std::min<std::size_t>(nWorkers, jobs.size());
+
+    // Without a thread pool (or with a single worker) the files are converted in turn on this thread
+    if (pThreadPool.isNull() || nWorkers < 2)
+    {
+        for (std::size_t jobIdx = 0; jobIdx < jobs.size(); ++jobIdx)
+        {
+            convertJob(jobs[jobIdx], mResults[jobIdx], convert);
+        }
+        return;
+    }
+
+    std::vector<std::unique_ptr<OdStaticRxObject<FileConversionTask>>> tasks;
+    std::atomic<std::size_t> nextJobIdx(0);
+
+    OdApcQueuePtr pQueue = pThreadPool->newMTQueue(ThreadsCounter::kMtLoadingAttributes | ThreadsCounter::kMtRegenAttributes, nWorkers);
+    for (unsigned int i = 0; i < nWorkers; ++i)
+    {
+        tasks.emplace_back(new OdStaticRxObject<FileConversionTask>());
+        tasks.back()->init(&jobs, &mResults, &nextJobIdx, &convert);
+        pQueue->addEntryPoint(tasks.back().get(), 0);
+    }
+    pQueue->wait();
+}
+
+std::size_t BatchConverter::failedCount() const
+{
+    return (std::size_t)std::count_if(mResults.begin(), mResults.end(), [](const Result& result) { return !result.ok; });
+}
+
+bool BatchConverter::writeSummary(const std::string& summaryFilename, const std::vector<Job>& jobs) const
+{
+    std::ofstream summaryStream(summaryFilename.c_str(), std::ofstream::out);
+    if (!summaryStream)
+    {
+        return false;
+    }
+
+    BrepJsonWriter writer(summaryStream, true);
+    writer.beginObject();
+    writer.value("files", static_cast<std::uint64_t>(mResults.size()));
+    writer.value("failed", static_cast<std::uint64_t>(failedCount()));
+
+    double totalSeconds = 0.0;
+    writer.beginArray("results");
+    for (std::size_t jobIdx = 0; jobIdx < mResults.size(); ++jobIdx)
+    {
+        const Result& result = mResults[jobIdx];
+        totalSeconds += result.totalSeconds;
+        writer.beginObject();
+        writer.value("input", jobs[jobIdx].input.c_str());
+        writer.value("output", jobs[jobIdx].output.c_str());
+        writer.value("status", result.ok ? "ok" : "failed");
+        if (!result.ok)
+        {
+            writer.value("error", result.error.c_str());
+        }
+        writer.value("products", static_cast<std::uint64_t>(result.productCount));
+        writer.value("readSeconds", result.readSeconds);
+        writer.value("convertSeconds", result.convertSeconds);
+        writer.value("writeSeconds", result.writeSeconds);
+        writer.value("totalSeconds", result.totalSeconds);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.value("totalSeconds", totalSeconds);
+    writer.endObject();
+    writer.flush();
+    return static_cast<bool>(summaryStream);
+}
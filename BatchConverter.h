@@ -0,0 +1,55 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Converts the files of a manifest in one process, so the SDK and the schema modules are initialised once.
+// Workers of the OdRxThreadPoolService pull the next file from a shared cursor, at most one file per worker is open
+// at a time. Every file gets a status and its stage timings, written to a json summary at the end.
+class BatchConverter
+{
+public:
+    struct Job
+    {
+        std::string input;
+        std::string output;
+    };
+
+    struct Result
+    {
+        bool ok = false;
+        std::string error;
+        std::size_t productCount = 0;
+        double readSeconds = 0.0;       // stage timings, filled by the convert function
+        double convertSeconds = 0.0;
+        double writeSeconds = 0.0;
+        double totalSeconds = 0.0;
+    };
+
+    // Converts one file and fills the product count and the stage timings, failures are thrown (OdError or std::exception).
+    // Must not keep the database open after returning
+    using ConvertFunction = std::function<void(const Job& job, Result& result)>;
+
+    // nWorkers == 0 uses one worker per CPU reported by the thread pool
+    explicit BatchConverter(unsigned int nWorkers = 1);
+    ~BatchConverter() = default;
+
+    // One job per line: input and output filename separated by a tab, or by spaces when there is no tab.
+    // Empty lines and lines starting with # are skipped
+    static bool readManifest(const std::string& manifestFilename, std::vector<Job>& jobs);
+
+    // Results are in manifest order
+    void run(const std::vector<Job>& jobs, const ConvertFunction& convert);
+
+    const std::vector<Result>& results() const { return mResults; }
+    std::size_t failedCount() const;
+
+    bool writeSummary(const std::string& summaryFilename, const std::vector<Job>& jobs) const;
+
+private:
+    unsigned int mWorkers;
+    std::vector<Result> mResults;
+};
@@ -0,0 +1,441 @@
+/************************************************************************/
+/* Benchmarks of the BrepGeometryModeler hot paths on synthetic models  */
+/************************************************************************/
+
+#include "OdaCommon.h"
+
+#include "StaticRxObject.h"
+#include "RxDynamicModule.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include "ExIfcHostAppServices.h"
+#include "ExPrintConsole.h"
+
+#include "BrepGeometryModeler.h"
+#include "AttributeHelper.h"
+#include "ProductTraversal.h"
+#include "PointWelder.h"
+#include "SyntheticIfcGenerator.h"
+#include "Log.h"
+
+#include <json/single_include/nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//
+// Define module map for statically linked modules:
+//
+#if !defined(_TOOLKIT_IN_DLL_)
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdSDAIModule);
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdIfcCoreModule);
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdIfc2x3Module);
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdIfc4Module);
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdIfcGeomModuleImpl);
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdIfcFacetModelerModule);
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdIfcBrepBuilderModule);
+  ODRX_DECLARE_STATIC_MODULE_ENTRY_POINT(OdRxThreadPoolService);
+  ODRX_BEGIN_STATIC_MODULE_MAP()
+    ODRX_DEFINE_STATIC_APPMODULE(OdSDAIModuleName, OdSDAIModule)
+    ODRX_DEFINE_STATIC_APPMODULE(OdIfcCoreModuleName, OdIfcCoreModule)
+    ODRX_DEFINE_STATIC_APPMODULE(OdIfc2x3ModuleName, OdIfc2x3Module)
+    ODRX_DEFINE_STATIC_APPMODULE(OdIfc4ModuleName, OdIfc4Module)
+    ODRX_DEFINE_STATIC_APPMODULE(OdIfcGeomModuleName, OdIfcGeomModuleImpl)
+    ODRX_DEFINE_STATIC_APPMODULE(OdIfcFacetModelerModuleName, OdIfcFacetModelerModule)
+    ODRX_DEFINE_STATIC_APPMODULE(OdIfcBrepBuilderModuleName, OdIfcBrepBuilderModule)
+    ODRX_DEFINE_STATIC_APPMODULE(OdThreadPoolModuleName, OdRxThreadPoolService)
+  ODRX_END_STATIC_MODULE_MAP()
+#endif
+
+class BrepGeometryModelerBenchmark
+{
+public:
+    static std::shared_ptr<FacetModeler::Body> getSurfaceModel(BrepGeometryModeler& modeler, OdIfc::OdIfcInstancePtr item)
+    {
+        return modeler.getSurfaceModel(item);
+    }
+
+    static std::shared_ptr<FacetModeler::Body> createCylinder(BrepGeometryModeler& modeler, double radius, double height)
+    {
+        return modeler.createCylinder(modeler.mDeviationPolicy.sweptSolid(radius), OdGePoint2d::kOrigin, OdGeVector2d::kXAxis, radius,
+            OdGeVector3d::kZAxis, height, OdGeMatrix3d::kIdentity);
+    }
+};
+
+namespace
+{
+    struct BenchmarkResult
+    {
+        std::string name;
+        double value;
+        const char* unit;
+        bool higherIsBetter;
+    };
+
+    double seconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Median over the runs of the nanoseconds per operation, run() returns the number of operations it did
+    template<typename F>
+    double measureNsPerOp(unsigned int repeat, F run)
+    {
+        std::vector<double> samples;
+        for (unsigned int i = 0; i < repeat; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const std::size_t ops = run();
+            samples.push_back(seconds(start) * 1e9 / static_cast<double>(std::max<std::size_t>(ops, 1)));
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    std::vector<OdIfc::OdIfcInstancePtr> instancesOf(OdIfcModel* pModel, const char* entityName)
+    {
+        std::vector<OdIfc::OdIfcInstancePtr> ret;
+        OdDAI::Set<OdDAIObjectId>* extent = pModel->getEntityExtent(entityName);
+        if (extent == nullptr || extent->isNil())
+        {
+            return ret;
+        }
+        for (OdDAI::ConstIteratorPtr it = extent->createConstIterator(); it->next();)
+        {
+            OdDAIObjectId id;
+            it->getCurrentMember() >> id;
+            OdIfc::OdIfcInstancePtr pInst = id.openObject();
+            if (!pInst.isNull())
+            {
+                ret.push_back(pInst);
+            }
+        }
+        return ret;
+    }
+
+    std::uint64_t fileSize(const std::string& filename)
+    {
+        std::ifstream fileStream(filename.c_str(), std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+        return fileStream ? static_cast<std::uint64_t>(fileStream.tellg()) : 0;
+    }
+
+    void convertAll(OdIfcModel* pModel, BrepGeometryModeler& modeler)
+    {
+        ProductTraversal productTraversal(pModel);
+        std::vector<OdDAIObjectId> productIds = productTraversal.collectProducts();
+        for (std::size_t productIdx = 0; productIdx < productIds.size(); ++productIdx)
+        {
+            OdIfc::OdIfcInstancePtr pInst = productIds[productIdx].openObject();
+            if (!pInst.isNull())
+            {
+                modeler.addProduct(pInst, productIdx);
+            }
+        }
+    }
+
+    bool writeResults(const std::string& filename, const SyntheticIfcGenerator::Params& params, const std::vector<BenchmarkResult>& results)
+    {
+        std::ofstream resultsStream(filename.c_str(), std::ofstream::out);
+        if (!resultsStream)
+        {
+            return false;
+        }
+        BrepJsonWriter writer(resultsStream, true);
+        writer.beginObject();
+        writer.beginObject("model");
+        writer.value("products", static_cast<std::uint64_t>(params.productCount));
+        writer.value("maps", static_cast<std::uint64_t>(params.mapCount));
+        writer.value("surfaceTriangles", static_cast<std::uint64_t>(params.surfaceTriangles));
+        writer.value("cylinders", static_cast<std::uint64_t>(params.cylinderCount));
+        writer.endObject();
+        writer.beginArray("results");
+        for (const auto& result : results)
+        {
+            writer.beginObject();
+            writer.value("name", result.name.c_str());
+            writer.value("value", result.value);
+            writer.value("unit", result.unit);
+            writer.value("higherIsBetter", result.higherIsBetter);
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.endObject();
+        writer.flush();
+        return static_cast<bool>(resultsStream);
+    }
+
+    // Prints every result that is worse than the baseline by more than threshold (0.1 = 10%), returns their count
+    int compareWithBaseline(const std::string& filename, const std::vector<BenchmarkResult>& results, double threshold)
+    {
+        std::ifstream baselineStream(filename.c_str(), std::ifstream::in);
+        nlohmann::json baseline = nlohmann::json::parse(baselineStream, nullptr, false);
+        if (baseline.is_discarded() || !baseline.contains("results"))
+        {
+            odPrintConsoleString(OD_T("\nCan't read the baseline %hs\n"), filename.c_str());
+            return -1;
+        }
+
+        int regressions = 0;
+        for (const auto& result : results)
+        {
+            for (const auto& baseResult : baseline["results"])
+            {
+                if (baseResult.value("name", std::string()) != result.name)
+                {
+                    continue;
+                }
+                const double baseValue = baseResult.value("value", 0.0);
+                if (baseValue <= 0.0)
+                {
+                    break;
+                }
+                const double change = result.higherIsBetter ? (baseValue - result.value) / baseValue : (result.value - baseValue) / baseValue;
+                const bool isRegression = change > threshold;
+                odPrintConsoleString(OD_T("\n%-36hs %12.3f -> %12.3f %hs %+6.1f%%%hs"), result.name.c_str(), baseValue, result.value, result.unit,
+                    (result.value - baseValue) / baseValue * 100.0, isRegression ? "  REGRESSION" : "");
+                regressions += isRegression ? 1 : 0;
+                break;
+            }
+        }
+        odPrintConsoleString(OD_T("\n"));
+        return regressions;
+    }
+}
+
+/************************************************************************/
+/* Main                                                                 */
+/************************************************************************/
+int main(int argc, char* argv[])
+{
+  int nRes = 0;
+
+  OdStaticRxObject<MyServices> svcs;
+
+  SyntheticIfcGenerator::Params params;
+  unsigned int repeat = 5;
+  double threshold = 0.1;
+  std::string strIfcFilename = "ifc2brep_bench.ifc";
+  std::string strBrepFilename = "ifc2brep_bench.json";
+  std::string strResultsFilename;
+  std::string strBaselineFilename;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "-products") == 0 && hasValue)
+    {
+      params.productCount = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "-maps") == 0 && hasValue)
+    {
+      params.mapCount = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "-triangles") == 0 && hasValue)
+    {
+      params.surfaceTriangles = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "-cylinders") == 0 && hasValue)
+    {
+      params.cylinderCount = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "-repeat") == 0 && hasValue)
+    {
+      repeat = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)));
+    }
+    else if (std::strcmp(argv[i], "-ifc") == 0 && hasValue)
+    {
+      strIfcFilename = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "-out") == 0 && hasValue)
+    {
+      strResultsFilename = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "-baseline") == 0 && hasValue)
+    {
+      strBaselineFilename = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "-threshold") == 0 && hasValue)
+    {
+      threshold = std::atof(argv[++i]) / 100.0;
+    }
+    else
+    {
+      odPrintConsoleString(OD_T("\n\tusage: IfcGeometriesBench [-products <n>] [-maps <n>] [-triangles <n>] [-cylinders <n>] [-repeat <n>] [-ifc <filename>] [-out <resultsFilename>] [-baseline <resultsFilename>] [-threshold <percent>]"));
+      odPrintConsoleString(OD_T("\n\tGenerates a synthetic IFC file, times the conversion steps and writes the results as json."));
+      odPrintConsoleString(OD_T("\n\t-baseline compares with earlier results, the exit code is 2 if a result is worse than the threshold (default 10%%).\n"));
+      return 1;
+    }
+  }
+
+  if (!SyntheticIfcGenerator(params).write(strIfcFilename))
+  {
+    odPrintConsoleString(OD_T("\nCan't write %hs\n"), strIfcFilename.c_str());
+    return 1;
+  }
+
+  Log::setLevel(LogLevel::Error);
+
+#if !defined(_TOOLKIT_IN_DLL_)
+  ODRX_INIT_STATIC_MODULE_MAP();
+#endif
+
+  odrxInitialize(&svcs);
+  odIfcInitialize(false /* No CDA */, true);
+
+  std::vector<BenchmarkResult> results;
+  try
+  {
+    // Welding of the points of separately written triangles, every point comes three times within the tolerance
+    {
+      std::vector<OdGePoint3d> points;
+      for (int i = 0; i < 100000; ++i)
+      {
+        const OdGePoint3d point(0.5 * (i % 100), 0.5 * ((i / 100) % 100), 0.5 * (i / 10000));
+        points.push_back(point);
+        points.push_back(point + OdGeVector3d(1e-10, 0.0, 0.0));
+        points.push_back(point + OdGeVector3d(0.0, -1e-10, 1e-10));
+      }
+      results.push_back({ "PointWelder::appendPointGetIdx", measureNsPerOp(repeat, [&]()
+      {
+        PointWelder welder(1e-9);
+        for (const auto& point : points)
+        {
+          welder.appendPointGetIdx(point);
+        }
+        return points.size();
+      }), "ns/op", false });
+    }
+
+    OdIfcFilePtr pDatabase = svcs.createDatabase();
+    if (pDatabase->readFile(OdString(strIfcFilename.c_str())) != eOk)
+    {
+      throw OdError(eCantOpenFile);
+    }
+    OdIfcModelPtr pModel = pDatabase->getModel();
+
+    {
+      std::vector<OdIfc::OdIfcInstancePtr> cartesianPoints = instancesOf(pModel, "ifccartesianpoint");
+      volatile double sink = 0.0;
+      results.push_back({ "AttributeHelper::getVector", measureNsPerOp(repeat, [&]()
+      {
+        for (const auto& point : cartesianPoints)
+        {
+          sink = sink + AttributeHelper::getVector<OdGeVector3d>(point, "coordinates").x;
+        }
+        return cartesianPoints.size();
+      }), "ns/op", false });
+    }
+
+    {
+      std::vector<OdIfc::OdIfcInstancePtr> surfaceModels = instancesOf(pModel, "ifcshellbasedsurfacemodel");
+
+      // Every surface model has surfaceTriangles faces, fewer means its shells (a SELECT aggregate) weren't read
+      {
+        BrepGeometryModeler modeler;
+        for (const auto& surfaceModel : surfaceModels)
+        {
+          std::shared_ptr<FacetModeler::Body> body = BrepGeometryModelerBenchmark::getSurfaceModel(modeler, surfaceModel);
+          if (static_cast<std::size_t>(body->faceCount()) != params.surfaceTriangles)
+          {
+            odPrintConsoleString(OD_T("\ngetSurfaceModel: #%llu has %llu faces instead of %llu\n"), (unsigned long long)(OdUInt64)surfaceModel->id().getHandle(),
+              (unsigned long long)body->faceCount(), (unsigned long long)params.surfaceTriangles);
+            nRes = 1;
+            break;
+          }
+        }
+      }
+
+      results.push_back({ "BrepGeometryModeler::getSurfaceModel", measureNsPerOp(repeat, [&]()
+      {
+        BrepGeometryModeler modeler;
+        for (const auto& surfaceModel : surfaceModels)
+        {
+          BrepGeometryModelerBenchmark::getSurfaceModel(modeler, surfaceModel);
+        }
+        return surfaceModels.size();
+      }), "ns/op", false });
+    }
+
+    {
+      const std::size_t cylinderCount = 1000;
+      results.push_back({ "BrepGeometryModeler::createCylinder", measureNsPerOp(repeat, [&]()
+      {
+        BrepGeometryModeler modeler;
+        for (std::size_t i = 0; i < cylinderCount; ++i)
+        {
+          BrepGeometryModelerBenchmark::createCylinder(modeler, 0.05 + 0.001 * static_cast<double>(i % 100), 3.0);
+        }
+        return cylinderCount;
+      }), "ns/op", false });
+    }
+
+    {
+      BrepGeometryModeler modeler;
+      convertAll(pModel, modeler);
+      results.push_back({ "BrepGeometryModeler::postProcessGeometries", measureNsPerOp(repeat, [&]()
+      {
+        modeler.postProcessGeometries(OdString(strBrepFilename.c_str()));
+        return static_cast<std::size_t>(1);
+      }) * 1e-6, "ms/run", false });
+    }
+
+    // End to end: read, select every product, convert and write, the median run by time
+    std::vector<double> runSeconds;
+    std::uint64_t outputBytes = 0;
+    for (unsigned int i = 0; i < repeat; ++i)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      OdIfcFilePtr pRunDatabase = svcs.createDatabase();
+      if (pRunDatabase->readFile(OdString(strIfcFilename.c_str())) != eOk)
+      {
+        throw OdError(eCantOpenFile);
+      }
+      BrepGeometryModeler modeler;
+      convertAll(pRunDatabase->getModel(), modeler);
+      modeler.postProcessGeometries(OdString(strBrepFilename.c_str()));
+      runSeconds.push_back(seconds(start));
+      outputBytes = fileSize(strBrepFilename);
+    }
+    std::sort(runSeconds.begin(), runSeconds.end());
+    const double medianSeconds = runSeconds[runSeconds.size() / 2];
+    results.push_back({ "endToEnd.products", static_cast<double>(params.productCount) / medianSeconds, "products/s", true });
+    results.push_back({ "endToEnd.output", static_cast<double>(outputBytes) / (1024.0 * 1024.0) / medianSeconds, "MB/s", true });
+  }
+  catch (OdError& e)
+  {
+    odPrintConsoleString(OD_T("\n\nError: %ls"), e.description().c_str());
+    nRes = -1;
+  }
+
+  for (const auto& result : results)
+  {
+    odPrintConsoleString(OD_T("\n%-44hs %12.3f %hs"), result.name.c_str(), result.value, result.unit);
+  }
+  odPrintConsoleString(OD_T("\n"));
+
+  if (nRes == 0 && !strResultsFilename.empty() && !writeResults(strResultsFilename, params, results))
+  {
+    odPrintConsoleString(OD_T("\nCan't write %hs\n"), strResultsFilename.c_str());
+    nRes = 1;
+  }
+  if (nRes == 0 && !strBaselineFilename.empty())
+  {
+    const int regressions = compareWithBaseline(strBaselineFilename, results, threshold);
+    nRes = (regressions < 0) ? 1 : (regressions > 0) ? 2 : 0;
+  }
+
+  Log::flush();
+
+  odIfcUninitialize();
+  odrxUninitialize();
+
+  return nRes;
+}
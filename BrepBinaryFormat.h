@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+
+// Binary BREP file layout, version 2. All values are little endian.
+//
+//   Header                                64 bytes
+//   Section[sectionCount]                 32 bytes each
+//   section data                          each section starts on a 64 byte boundary
+//
+// The arrays of a section are plain C arrays of the section element type, so a reader can map the file and
+// use them in place.
+namespace BrepBinary
+{
+    const char kMagic[8] = { 'I', 'F', 'C', '2', 'B', 'R', 'E', 'P' };
+    const std::uint32_t kVersion = 2;
+    const std::uint32_t kEndianTag = 0x01020304u;
+    const std::uint64_t kAlignment = 64;
+    const std::uint64_t kNoSolid = ~0ull;
+
+    enum SectionType : std::uint32_t
+    {
+        kSectionVertices = 1,         // Vertex[vertexCount]
+        kSectionEdgeVertices = 2,     // EdgeVertices[edgeCount]
+        kSectionEdgeArcLengths = 3,   // double[edgeCount]
+        kSectionFaceAreas = 4,        // double[faceCount]
+        kSectionGeometries = 5,       // Geometry[geometryCount]
+        kSectionSolids = 6,           // std::uint64_t[solidCount], geometry index of each solid
+        kSectionInstances = 7,        // Instance[instanceCount]
+        kSectionFaces = 8,            // Face[faceCount]
+        kSectionFaceEdges = 9,        // FaceEdge[sum of the face edge counts]
+        kSectionGeometryLods = 10,    // GeometryLod[lodCount], coarser levels of detail of the solids
+        kSectionPrimitives = 11,      // Primitive[primitiveCount]
+        kSectionProfilePoints = 12    // ProfilePoint[sum of the primitive profile point counts]
+    };
+
+    enum GeometryType : std::uint32_t
+    {
+        kGeometrySurface = 0,
+        kGeometrySolid = 1,
+        kGeometryPrimitive = 2        // no edges or faces, described by its Primitive
+    };
+
+    enum PrimitiveType : std::uint32_t
+    {
+        kPrimitiveCylinder = 0,
+        kPrimitivePolygonExtrusion = 1
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endianTag;
+        std::uint64_t fileSize;
+        std::uint32_t sectionCount;
+        std::uint32_t reserved0;
+        std::uint64_t reserved[4];
+    };
+    static_assert(sizeof(Header) == 64, "Header must be 64 bytes");
+
+    struct Section
+    {
+        std::uint32_t type;
+        std::uint32_t elementSize;
+        std::uint64_t offset;
+        std::uint64_t count;
+        std::uint64_t reserved;
+    };
+    static_assert(sizeof(Section) == 32, "Section must be 32 bytes");
+
+    struct Vertex
+    {
+        double position[3];
+    };
+    static_assert(sizeof(Vertex) == 24, "Vertex must be 24 bytes");
+
+    struct EdgeVertices
+    {
+        std::uint64_t vertices[2];
+    };
+    static_assert(sizeof(EdgeVertices) == 16, "EdgeVertices must be 16 bytes");
+
+    // Edges and faces of a geometry are contiguous ranges of the edge and face sections,
+    // an edge is shared by the faces of its geometry that run along it
+    struct Geometry
+    {
+        std::uint32_t type;
+        std::uint32_t reserved;
+        std::uint64_t solidIdx;       // kNoSolid for surfaces
+        std::uint64_t firstEdge;
+        std::uint64_t edgeCount;
+        std::uint64_t firstFace;
+        std::uint64_t faceCount;
+    };
+    static_assert(sizeof(Geometry) == 48, "Geometry must be 48 bytes");
+
+    // Loop of a face, a range of the face edge section
+    struct Face
+    {
+        std::uint64_t firstFaceEdge;
+        std::uint64_t faceEdgeCount;
+    };
+    static_assert(sizeof(Face) == 16, "Face must be 16 bytes");
+
+    // Use of an edge by a face loop, reversed if the loop runs from vertices[1] to vertices[0]
+    struct FaceEdge
+    {
+        std::uint64_t edgeIdx;
+        std::uint32_t reversed;
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(FaceEdge) == 16, "FaceEdge must be 16 bytes");
+
+    // Geometry that is a coarser level of detail of a level 0 geometry, instances only reference level 0 geometries
+    struct GeometryLod
+    {
+        std::uint64_t geometryIdx;
+        std::uint64_t baseGeometryIdx;
+        std::uint32_t level;
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(GeometryLod) == 24, "GeometryLod must be 24 bytes");
+
+    // Analytic extrusion of a kGeometryPrimitive geometry: a circle of radius around the origin, or the polygon of a
+    // range of the profile point section, in the xy plane of placement, swept along extrusion (placement coordinates)
+    struct Primitive
+    {
+        std::uint64_t geometryIdx;
+        std::uint32_t type;
+        std::uint32_t reserved;
+        double placement[16];         // row major
+        double extrusion[3];
+        double radius;                // 0 for polygons
+        std::uint64_t firstProfilePoint;
+        std::uint64_t profilePointCount;
+    };
+    static_assert(sizeof(Primitive) == 192, "Primitive must be 192 bytes");
+
+    // Counterclockwise polygon point of a primitive profile
+    struct ProfilePoint
+    {
+        double position[2];
+    };
+    static_assert(sizeof(ProfilePoint) == 16, "ProfilePoint must be 16 bytes");
+
+    // Row major 4x4 placement of a geometry
+    struct Instance
+    {
+        std::uint64_t geometryIdx;
+        double transform[16];
+    };
+    static_assert(sizeof(Instance) == 136, "Instance must be 136 bytes");
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+// Header only reader of the binary BREP format (see BrepBinaryFormat.h).
+// The file is memory mapped and validated once, the sections are then exposed as read only spans over the mapping.
+//
+//   BrepBinaryReader reader;
+//   if (reader.open("model.brepb"))
+//       for (const BrepBinary::Vertex& vertex : reader.vertices()) ...
+
+#include "BrepBinaryFormat.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+template<typename T>
+class BrepSpan
+{
+public:
+    BrepSpan() = default;
+    BrepSpan(const T* data, std::size_t size) : mData(data), mSize(size) {}
+
+    const T* data() const { return mData; }
+    std::size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    const T& operator[](std::size_t idx) const { return mData[idx]; }
+    const T* begin() const { return mData; }
+    const T* end() const { return mData + mSize; }
+
+private:
+    const T* mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+class BrepBinaryReader
+{
+public:
+    BrepBinaryReader() = default;
+    ~BrepBinaryReader() { close(); }
+
+    BrepBinaryReader(const BrepBinaryReader&) = delete;
+    BrepBinaryReader& operator=(const BrepBinaryReader&) = delete;
+
+    // Maps and validates the file, error() describes the failure when false is returned
+    bool open(const char* filename)
+    {
+        close();
+        if (!map(filename))
+        {
+            return false;
+        }
+        if (!validate())
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#if defined(_WIN32)
+        if (mData != nullptr)
+        {
+            UnmapViewOfFile(mData);
+        }
+        if (mMapping != NULL)
+        {
+            CloseHandle(mMapping);
+        }
+        if (mFile != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(mFile);
+        }
+        mMapping = NULL;
+        mFile = INVALID_HANDLE_VALUE;
+#else
+        if (mData != nullptr)
+        {
+            munmap(const_cast<unsigned char*>(mData), mSize);
+        }
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    const std::string& error() const { return mError; }
+
+    const BrepBinary::Header& header() const { return *reinterpret_cast<const BrepBinary::Header*>(mData); }
+
+    BrepSpan<BrepBinary::Vertex> vertices() const { return section<BrepBinary::Vertex>(BrepBinary::kSectionVertices); }
+    BrepSpan<BrepBinary::EdgeVertices> edgeVertices() const { return section<BrepBinary::EdgeVertices>(BrepBinary::kSectionEdgeVertices); }
+    BrepSpan<double> edgeArcLengths() const { return section<double>(BrepBinary::kSectionEdgeArcLengths); }
+    BrepSpan<double> faceAreas() const { return section<double>(BrepBinary::kSectionFaceAreas); }
+    BrepSpan<BrepBinary::Face> faces() const { return section<BrepBinary::Face>(BrepBinary::kSectionFaces); }
+    BrepSpan<BrepBinary::FaceEdge> faceEdges() const { return section<BrepBinary::FaceEdge>(BrepBinary::kSectionFaceEdges); }
+    BrepSpan<BrepBinary::Geometry> geometries() const { return section<BrepBinary::Geometry>(BrepBinary::kSectionGeometries); }
+    BrepSpan<std::uint64_t> solids() const { return section<std::uint64_t>(BrepBinary::kSectionSolids); }
+    BrepSpan<BrepBinary::Instance> instances() const { return section<BrepBinary::Instance>(BrepBinary::kSectionInstances); }
+    BrepSpan<BrepBinary::GeometryLod> geometryLods() const { return section<BrepBinary::GeometryLod>(BrepBinary::kSectionGeometryLods); }
+    BrepSpan<BrepBinary::Primitive> primitives() const { return section<BrepBinary::Primitive>(BrepBinary::kSectionPrimitives); }
+    BrepSpan<BrepBinary::ProfilePoint> profilePoints() const { return section<BrepBinary::ProfilePoint>(BrepBinary::kSectionProfilePoints); }
+
+private:
+    bool map(const char* filename)
+    {
+#if defined(_WIN32)
+        mFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (mFile == INVALID_HANDLE_VALUE)
+        {
+            return fail("can't open file");
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(BrepBinary::Header))
+        {
+            return fail("file too small");
+        }
+        mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mMapping == NULL)
+        {
+            return fail("can't map file");
+        }
+        mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+        if (mData == nullptr)
+        {
+            return fail("can't map file");
+        }
+        mSize = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(filename, O_RDONLY);
+        if (fd < 0)
+        {
+            return fail("can't open file");
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(BrepBinary::Header))
+        {
+            ::close(fd);
+            return fail("file too small");
+        }
+        void* data = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            return fail("can't map file");
+        }
+        mData = static_cast<const unsigned char*>(data);
+        mSize = static_cast<std::size_t>(fileStat.st_size);
+#endif
+        return true;
+    }
+
+    bool validate()
+    {
+        const BrepBinary::Header& hdr = header();
+        if (std::memcmp(hdr.magic, BrepBinary::kMagic, sizeof(BrepBinary::kMagic)) != 0)
+        {
+            return fail("not a binary BREP file");
+        }
+        if (hdr.endianTag != BrepBinary::kEndianTag)
+        {
+            return fail("unsupported byte order");
+        }
+        if (hdr.version != BrepBinary::kVersion)
+        {
+            return fail("unsupported version");
+        }
+        if (hdr.fileSize != mSize)
+        {
+            return fail("truncated file");
+        }
+        if (sizeof(BrepBinary::Header) + std::uint64_t(hdr.sectionCount) * sizeof(BrepBinary::Section) > mSize)
+        {
+            return fail("truncated section table");
+        }
+
+        for (std::uint32_t i = 0; i < hdr.sectionCount; ++i)
+        {
+            const BrepBinary::Section& sec = sections()[i];
+            const std::uint32_t expectedSize = elementSize(sec.type);
+            if (expectedSize != 0 && sec.elementSize != expectedSize)
+            {
+                return fail("unexpected section element size");
+            }
+            if (sec.offset % BrepBinary::kAlignment != 0)
+            {
+                return fail("misaligned section");
+            }
+            if (sec.offset > mSize || (sec.elementSize != 0 && sec.count > (mSize - sec.offset) / sec.elementSize))
+            {
+                return fail("section out of file bounds");
+            }
+        }
+        return true;
+    }
+
+    const BrepBinary::Section* sections() const
+    {
+        return reinterpret_cast<const BrepBinary::Section*>(mData + sizeof(BrepBinary::Header));
+    }
+
+    template<typename T>
+    BrepSpan<T> section(std::uint32_t type) const
+    {
+        if (mData == nullptr)
+        {
+            return BrepSpan<T>();
+        }
+        for (std::uint32_t i = 0; i < header().sectionCount; ++i)
+        {
+            const BrepBinary::Section& sec = sections()[i];
+            if (sec.type == type)
+            {
+                return BrepSpan<T>(reinterpret_cast<const T*>(mData + sec.offset), static_cast<std::size_t>(sec.count));
+            }
+        }
+        return BrepSpan<T>();
+    }
+
+    static std::uint32_t elementSize(std::uint32_t type)
+    {
+        switch (type)
+        {
+        case BrepBinary::kSectionVertices: return sizeof(BrepBinary::Vertex);
+        case BrepBinary::kSectionEdgeVertices: return sizeof(BrepBinary::EdgeVertices);
+        case BrepBinary::kSectionEdgeArcLengths: return sizeof(double);
+        case BrepBinary::kSectionFaceAreas: return sizeof(double);
+        case BrepBinary::kSectionGeometries: return sizeof(BrepBinary::Geometry);
+        case BrepBinary::kSectionSolids: return sizeof(std::uint64_t);
+        case BrepBinary::kSectionInstances: return sizeof(BrepBinary::Instance);
+        case BrepBinary::kSectionFaces: return sizeof(BrepBinary::Face);
+        case BrepBinary::kSectionFaceEdges: return sizeof(BrepBinary::FaceEdge);
+        case BrepBinary::kSectionGeometryLods: return sizeof(BrepBinary::GeometryLod);
+        case BrepBinary::kSectionPrimitives: return sizeof(BrepBinary::Primitive);
+        case BrepBinary::kSectionProfilePoints: return sizeof(BrepBinary::ProfilePoint);
+        }
+        // Sections of newer minor revisions are skipped
+        return 0;
+    }
+
+    bool fail(const char* error)
+    {
+        mError = error;
+        return false;
+    }
+
+    const unsigned char* mData = nullptr;
+    std::size_t mSize = 0;
+    std::string mError;
+#if defined(_WIN32)
+    HANDLE mFile = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = NULL;
+#endif
+};
@@ -0,0 +1,85 @@
+#include "BrepBinaryWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    std::uint64_t alignUp(std::uint64_t offset)
+    {
+        return (offset + BrepBinary::kAlignment - 1) / BrepBinary::kAlignment * BrepBinary::kAlignment;
+    }
+
+    // A short source is padded with zeros, the layout written to the header stays valid
+    void copy(std::istream& source, std::ostream& target, std::uint64_t size)
+    {
+        std::vector<char> chunk(static_cast<std::size_t>(std::min<std::uint64_t>(size, 1 << 20)));
+        while (size != 0)
+        {
+            const std::size_t chunkSize = static_cast<std::size_t>(std::min<std::uint64_t>(size, chunk.size()));
+            source.read(chunk.data(), static_cast<std::streamsize>(chunkSize));
+            std::fill(chunk.begin() + static_cast<std::ptrdiff_t>(source.gcount()), chunk.begin() + static_cast<std::ptrdiff_t>(chunkSize), '\0');
+            target.write(chunk.data(), static_cast<std::streamsize>(chunkSize));
+            size -= chunkSize;
+        }
+    }
+}
+
+bool BrepBinaryWriter::write(std::ostream& stream) const
+{
+    // Lay out the sections first, the header carries the final file size
+    std::vector<BrepBinary::Section> table(mSections.size());
+    std::uint64_t offset = alignUp(sizeof(BrepBinary::Header) + table.size() * sizeof(BrepBinary::Section));
+    for (std::size_t i = 0; i < mSections.size(); ++i)
+    {
+        table[i].type = mSections[i].type;
+        table[i].elementSize = mSections[i].elementSize;
+        table[i].offset = offset;
+        table[i].count = mSections[i].count;
+        table[i].reserved = 0;
+        offset = alignUp(offset + table[i].count * table[i].elementSize);
+    }
+
+    BrepBinary::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BrepBinary::kMagic, sizeof(header.magic));
+    header.version = BrepBinary::kVersion;
+    header.endianTag = BrepBinary::kEndianTag;
+    header.fileSize = offset;
+    header.sectionCount = static_cast<std::uint32_t>(table.size());
+
+    const char padding[BrepBinary::kAlignment] = {};
+    std::uint64_t position = 0;
+    auto pad = [&](std::uint64_t target)
+    {
+        stream.write(padding, static_cast<std::streamsize>(target - position));
+        position = target;
+    };
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    position += sizeof(header);
+    if (!table.empty())
+    {
+        stream.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(BrepBinary::Section)));
+        position += table.size() * sizeof(BrepBinary::Section);
+    }
+
+    for (std::size_t i = 0; i < mSections.size(); ++i)
+    {
+        pad(table[i].offset);
+        const std::uint64_t size = table[i].count * table[i].elementSize;
+        if (size != 0 && mSections[i].stream != nullptr)
+        {
+            copy(*mSections[i].stream, stream, size);
+            position += size;
+        }
+        else if (size != 0)
+        {
+            stream.write(static_cast<const char*>(mSections[i].elements), static_cast<std::streamsize>(size));
+            position += size;
+        }
+    }
+    pad(offset);
+
+    return static_cast<bool>(stream);
+}
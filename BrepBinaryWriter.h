@@ -0,0 +1,44 @@
+#pragma once
+
+#include "BrepBinaryFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+// Writer of the binary BREP format (see BrepBinaryFormat.h).
+// Sections are registered with pointers to their element arrays, write() then emits the header, the section table
+// and every section with a single stream write. The arrays must stay alive until write() returns.
+// Sections spilled to a file by a streamed conversion are registered with their stream instead and copied in chunks.
+class BrepBinaryWriter
+{
+public:
+    template<typename T>
+    void addSection(BrepBinary::SectionType type, const T* elements, std::size_t count)
+    {
+        mSections.push_back({ type, static_cast<std::uint32_t>(sizeof(T)), elements, nullptr, count });
+    }
+
+    // count elements of elementSize bytes, read from the current position of elements
+    void addSection(BrepBinary::SectionType type, std::uint32_t elementSize, std::istream* elements, std::size_t count)
+    {
+        mSections.push_back({ type, elementSize, nullptr, elements, count });
+    }
+
+    // Returns false if the stream failed
+    bool write(std::ostream& stream) const;
+
+private:
+    struct PendingSection
+    {
+        BrepBinary::SectionType type;
+        std::uint32_t elementSize;
+        const void* elements;
+        std::istream* stream;
+        std::size_t count;
+    };
+
+    std::vector<PendingSection> mSections;
+};
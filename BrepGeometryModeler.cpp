@@ -1,307 +1,1092 @@
 #include "BrepGeometryModeler.h"
 #include "AttributeHelper.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "ScratchArena.h"
+
+void BrepGeometryModeler::addProduct(OdIfc::OdIfcInstancePtr product, std::size_t productIdx)
+{
+    BREP_PROFILE_SCOPE("addProduct");
+    Profiler::count(ProfileCounter::ProductsConverted);
+    // The temporaries of the product are released at once when it is done
+    ScratchArena::Scope scratchScope(ScratchArena::threadArena());
+
+    // An unchanged product is spliced from the fragment cache instead of being converted
+    if (mFragmentCache && addCachedProduct(product))
+    {
+        return;
+    }
+    mCurrentProductIdx = productIdx;
+
+    OdIfc::OdIfcInstancePtr objectPlacement = AttributeHelper::getAttributeAsInstance(product, "objectplacement");
+        OdIfc::OdIfcInstancePtr relativePlacement = AttributeHelper::getAttributeAsInstance(objectPlacement, "relativeplacement");
+            OdIfc::OdIfcInstancePtr location = AttributeHelper::getAttributeAsInstance(relativePlacement, "location");
+            OdIfc::OdIfcInstancePtr axis = AttributeHelper::getAttributeAsInstance(relativePlacement, "axis");
+            OdIfc::OdIfcInstancePtr refdirection = AttributeHelper::getAttributeAsInstance(relativePlacement, "refdirection");
+            {
+                OdGeVector3d coordinates = AttributeHelper::getVector<OdGeVector3d>(location, "coordinates");
+                OdGeVector3d directionratiosAxis = AttributeHelper::getVector<OdGeVector3d>(axis, "directionratios");
+                OdGeVector3d directionratiosRefdirection = AttributeHelper::getVector<OdGeVector3d>(refdirection, "directionratios");
+                // Don't dump --> std::cout << coordinates.x << " , " << coordinates.y << " , " << coordinates.z << std::endl;
+                // Don't dump --> std::cout << directionratiosAxis.x << " , " << directionratiosAxis.y << " , " << directionratiosAxis.z << std::endl;
+                // Don't dump --> std::cout << directionratiosRefdirection.x << " , " << directionratiosRefdirection.y << " , " << directionratiosRefdirection.z << std::endl;
+            }
+
+    OdIfc::OdIfcInstancePtr representation = AttributeHelper::getAttributeAsInstance(product, "representation");                                          // Don't dump --> dumpEntity(representation, representation->getInstanceType());
+    if (representation.isNull())
+    {
+        return;
+    }
+    AttributeHelper::InstanceRange representations = AttributeHelper::getAttributeAsInstanceRange(representation, "representations");
+    for (const auto& shapeRepresentation : representations)
+    {
+        // Axis, FootPrint, Box etc. representations describe the same product again, only the body is converted
+        const char* identifier = nullptr;
+        if ((AttributeHelper::getAttr(shapeRepresentation, "representationidentifier") >> identifier) && identifier != nullptr && strcmp(identifier, "Body") != 0)
+        {
+            continue;
+        }
+
+        AttributeHelper::InstanceRange items = AttributeHelper::getAttributeAsInstanceRange(shapeRepresentation, "items");                      // Don't dump --> dumpEntity(items[0], items[0]->getInstanceType());
+        for (const auto& item : items)
+        {
+            if (item->isKindOf(OdIfc::kIfcMappedItem))
+            {
+                addMappedItem(item);
+            }
+            else
+            {
+                std::size_t geometryIdx = nextGeometryIdx();
+                if (addItem(item))
+                {
+                    mInstances.push_back({ geometryIdx, mCurrentProductIdx, OdGeMatrix3d::kIdentity });
+                }
+            }
+        }
+        BREP_LOG(Debug, "length of items: " << items.size());
+    }
+
+    if (mStreamOutput)
+    {
+        streamGeometries();
+    }
+}
+
+bool BrepGeometryModeler::addCachedProduct(OdIfc::OdIfcInstancePtr product)
+{
+    BREP_PROFILE_SCOPE("fragmentCache");
+    // Cached fragments can't reference the geometries of other products, representation maps are converted per product
+    mRepresentationMapCache.clear();
+    mProductHash = mProductHasher->hash(product);
+    BrepFragment fragment;
+    if (mProductHash == 0 || !mFragmentCache->load(mProductHash, fragment))
+    {
+        Profiler::count(ProfileCounter::FragmentCacheMisses);
+        return false;
+    }
+    Profiler::count(ProfileCounter::FragmentCacheHits);
+    for (auto& instance : fragment.sections.instances)
+    {
+        instance.geometryIdx += mStreamedGeometryCount;
+    }
+    appendFragment(fragment);
+    return true;
+}
+
+bool BrepGeometryModeler::addItem(OdIfc::OdIfcInstancePtr item)
+{
+    if (item->isKindOf(OdIfc::kIfcShellBasedSurfaceModel))
+    {
+        addMappedItemAsSurface(item);
+        return true;
+    }
+    else if (item->isKindOf(OdIfc::kIfcExtrudedAreaSolid))
+    {
+        // Profile types the profile cache can't build are skipped
+        OdIfc::OdIfcInstancePtr sweptarea = AttributeHelper::getAttributeAsInstance(item, "sweptarea");
+        if (mProfileCache.get(sweptarea) != nullptr)
+        {
+            addMappedItemAsSolid(item);
+            return true;
+        }
+    }
+    return false;
+}
+
+void BrepGeometryModeler::addMappedItem(OdIfc::OdIfcInstancePtr mappedItem)
+{
+    OdIfc::OdIfcInstancePtr mappingsource = AttributeHelper::getAttributeAsInstance(mappedItem, "mappingsource");                                     // Don't dump --> dumpEntity(mappingsource, mappingsource->getInstanceType());
+    if (mappingsource.isNull())
+    {
+        return;
+    }
+
+    const RepresentationMapKey key = { (OdUInt64)mappingsource->id().getHandle(), mDeviationPolicy.quality(), mDeviationPolicy.lodCount() };
+    auto it = mRepresentationMapCache.find(key);
+    if (it == mRepresentationMapCache.end())
+    {
+        std::vector<std::size_t> geometryIndices;
+        OdIfc::OdIfcInstancePtr mappedrepresentation = AttributeHelper::getAttributeAsInstance(mappingsource, "mappedrepresentation");                  // Don't dump --> dumpEntity(mappedrepresentation, mappedrepresentation->getInstanceType());
+        AttributeHelper::InstanceRange mappedItems = AttributeHelper::getAttributeAsInstanceRange(mappedrepresentation, "items");
+        for (const auto& item : mappedItems)
+        {
+            std::size_t geometryIdx = nextGeometryIdx();
+            if (addItem(item))
+            {
+                geometryIndices.push_back(geometryIdx);
+            }
+        }
+        it = mRepresentationMapCache.emplace(key, std::move(geometryIndices)).first;
+    }
+
+    const OdGeMatrix3d transform = getMappingTransform(mappedItem, mappingsource);
+    for (std::size_t geometryIdx : it->second)
+    {
+        mInstances.push_back({ geometryIdx, mCurrentProductIdx, transform });
+    }
+}
+
+OdGeMatrix3d BrepGeometryModeler::getMappingTransform(OdIfc::OdIfcInstancePtr mappedItem, OdIfc::OdIfcInstancePtr mappingsource)
+{
+    // IfcCartesianTransformationOperator3D(nonUniform), the axes default to the global ones and the scales to 1
+    OdGeMatrix3d target;
+    OdIfc::OdIfcInstancePtr mappingtarget = AttributeHelper::getAttributeAsInstance(mappedItem, "mappingtarget");
+    if (!mappingtarget.isNull())
+    {
+        OdGeVector3d localorigin = AttributeHelper::getVector<OdGeVector3d>(mappingtarget, "localorigin", "coordinates");
+        OdGeVector3d axis1 = AttributeHelper::getVector<OdGeVector3d>(mappingtarget, "axis1", "directionratios");
+        OdGeVector3d axis2 = AttributeHelper::getVector<OdGeVector3d>(mappingtarget, "axis2", "directionratios");
+        OdGeVector3d axis3 = AttributeHelper::getVector<OdGeVector3d>(mappingtarget, "axis3", "directionratios");
+        double scale = AttributeHelper::getOptionalDouble(mappingtarget, "scale", 1.0);
+        double scale2 = AttributeHelper::getOptionalDouble(mappingtarget, "scale2", scale);
+        double scale3 = AttributeHelper::getOptionalDouble(mappingtarget, "scale3", scale);
+
+        OdGeVector3d x_axis = axis1.isZeroLength() ? OdGeVector3d::kXAxis : axis1.normal();
+        OdGeVector3d z_axis = !axis3.isZeroLength() ? axis3.normal() : axis2.isZeroLength() ? OdGeVector3d::kZAxis : x_axis.crossProduct(axis2).normal();
+        OdGeVector3d y_axis = z_axis.crossProduct(x_axis).normal();
+        x_axis = y_axis.crossProduct(z_axis);
+        target.setCoordSystem(localorigin.asPoint(), x_axis * scale, y_axis * scale2, z_axis * scale3);
+    }
+
+    // IfcAxis2Placement3D of the mapped representation
+    OdGeMatrix3d origin;
+    OdIfc::OdIfcInstancePtr mappingorigin = AttributeHelper::getAttributeAsInstance(mappingsource, "mappingorigin");
+    if (!mappingorigin.isNull())
+    {
+        OdGeVector3d location = AttributeHelper::getVector<OdGeVector3d>(mappingorigin, "location", "coordinates");
+        OdGeVector3d axis = AttributeHelper::getVector<OdGeVector3d>(mappingorigin, "axis", "directionratios");
+        OdGeVector3d refdirection = AttributeHelper::getVector<OdGeVector3d>(mappingorigin, "refdirection", "directionratios");
+        OdGeVector3d z_axis = axis.isZeroLength() ? OdGeVector3d::kZAxis : axis.normal();
+        OdGeVector3d x_axis = refdirection.isZeroLength() ? OdGeVector3d::kXAxis : refdirection.normal();
+        OdGeVector3d y_axis = z_axis.crossProduct(x_axis).normal();
+        x_axis = y_axis.crossProduct(z_axis);
+        origin.setCoordSystem(location.asPoint(), x_axis, y_axis, z_axis);
+    }
+
+    return target * origin;
+}
 
 void BrepGeometryModeler::addMappedItemAsSurface(OdIfc::OdIfcInstancePtr mappedItem)
 {
     mGeometries.emplace_back(getSurfaceModel(mappedItem));
+    mGeometryLods.emplace_back();
+    mGeometryPrimitives.emplace_back();
+    Profiler::count(ProfileCounter::GeometriesConverted);
     mGeometryTypes.push_back(GeometryTypeEnum::GeometryTypeSurface);
+    mGeometryProductIndices.push_back(mCurrentProductIdx);
 }
 
 void BrepGeometryModeler::addMappedItemAsSolid(OdIfc::OdIfcInstancePtr mappedItem)
 {
-    mGeometries.emplace_back(getSweptSolid(mappedItem));
-    mGeometryTypes.push_back(GeometryTypeEnum::GeometryTypeSolid);
+    // Recognised primitives aren't tessellated at all in primitive output mode
+    std::shared_ptr<const ExtrusionPrimitive> primitive = mPrimitiveOutput ? getExtrusionPrimitive(mappedItem) : nullptr;
+    if (primitive)
+    {
+        mGeometries.emplace_back();
+        mGeometryLods.emplace_back();
+        mGeometryPrimitives.push_back(std::move(primitive));
+        mGeometryTypes.push_back(GeometryTypeEnum::GeometryTypePrimitive);
+    }
+    else
+    {
+        std::vector<std::shared_ptr<FacetModeler::Body>> lods = getSweptSolid(mappedItem);
+        mGeometries.emplace_back(std::move(lods.front()));
+        mGeometryLods.emplace_back(lods.begin() + 1, lods.end());
+        mPendingLodCount += lods.size() - 1;
+        mGeometryPrimitives.emplace_back();
+        mGeometryTypes.push_back(GeometryTypeEnum::GeometryTypeSolid);
+    }
+    Profiler::count(ProfileCounter::GeometriesConverted);
+    mGeometryProductIndices.push_back(mCurrentProductIdx);
+}
+
+BrepGeometryModeler BrepGeometryModeler::createShard() const
+{
+    BrepGeometryModeler shard;
+    shard.mDeviationPolicy = mDeviationPolicy;
+    shard.mWeldTolerance = mWeldTolerance;
+    shard.mPrimitiveOutput = mPrimitiveOutput;
+    return shard;
 }
 
-void BrepGeometryModeler::postProcessGeometries(const OdString& strBrepFilename)
+void BrepGeometryModeler::mergeShards(std::vector<BrepGeometryModeler>& shards)
 {
-    OdGePoint3dMap vertices;
-    std::vector<std::array<std::size_t, 2>> edgeIndices;
-    std::vector<double> edgeLengths;
-    std::vector<double> faceAreas;
-    for (const auto& body : mGeometries)
+    BREP_PROFILE_SCOPE("mergeShards");
+    struct GeometryRef
     {
-        FacetModeler::Vertex* vertex = body->vertexList();
-        for (std::size_t i = 0; i < body->vertexCount(); ++i, vertex = vertex->next())
+        std::size_t productIdx;
+        std::size_t shardIdx;
+        std::size_t geometryIdx;
+    };
+
+    // A representation map used by several shards has been converted by each of them, keep the conversion
+    // of the shard that met it first (smallest product index) and drop the others
+    std::vector<std::vector<std::size_t>> geometryRemaps(shards.size());
+    std::map<RepresentationMapKey, std::pair<std::size_t, std::size_t>> mapOwners;
+    for (std::size_t shardIdx = 0; shardIdx < shards.size(); ++shardIdx)
+    {
+        const BrepGeometryModeler& shard = shards[shardIdx];
+        geometryRemaps[shardIdx].assign(shard.mGeometries.size(), 0);
+        for (const auto& entry : shard.mRepresentationMapCache)
         {
-            std::size_t id = appendPointGetIdx(vertices, vertex->point());
+            if (entry.second.empty())
+            {
+                continue;
+            }
+            const std::size_t productIdx = shard.mGeometryProductIndices[entry.second.front()];
+            auto owner = mapOwners.find(entry.first);
+            if (owner == mapOwners.end() || productIdx < owner->second.first)
+            {
+                mapOwners[entry.first] = std::make_pair(productIdx, shardIdx);
+            }
         }
+    }
 
-        FacetModeler::Face* face = body->faceList();
-        for (std::size_t i = 0; i < body->faceCount(); ++i, face = face->next())
+    const std::size_t kDropped = std::numeric_limits<std::size_t>::max();
+    std::vector<GeometryRef> geometryRefs;
+    for (std::size_t shardIdx = 0; shardIdx < shards.size(); ++shardIdx)
+    {
+        const BrepGeometryModeler& shard = shards[shardIdx];
+        for (const auto& entry : shard.mRepresentationMapCache)
         {
-            FacetModeler::Edge* edge = face->edge();
-            for (std::size_t j = 0; j < face->loopEdgeCount(); ++j, edge = edge->next())
+            auto owner = mapOwners.find(entry.first);
+            if (owner != mapOwners.end() && owner->second.second != shardIdx)
+            {
+                for (std::size_t geometryIdx : entry.second)
+                {
+                    geometryRemaps[shardIdx][geometryIdx] = kDropped;
+                }
+            }
+        }
+        for (std::size_t i = 0; i < shard.mGeometries.size(); ++i)
+        {
+            if (geometryRemaps[shardIdx][i] != kDropped)
             {
-                std::array<std::size_t, 2> edgeIdx = { vertices[edge->startPoint()], vertices[edge->endPoint()] };
-                edgeIndices.push_back(edgeIdx);
-                edgeLengths.push_back(edge->length());
+                geometryRefs.push_back({ shard.mGeometryProductIndices[i], shardIdx, i });
             }
-            faceAreas.push_back(face->area());
         }
     }
 
-    // Dump to json
-    nlohmann::json brepDoc;
+    // A product is always converted by a single shard, so (productIdx, geometryIdx) is a total order
+    std::sort(geometryRefs.begin(), geometryRefs.end(), [](const GeometryRef& lhs, const GeometryRef& rhs)
+        {
+            return (lhs.productIdx != rhs.productIdx) ? lhs.productIdx < rhs.productIdx : lhs.geometryIdx < rhs.geometryIdx;
+        });
+
+    mGeometries.reserve(mGeometries.size() + geometryRefs.size());
+    for (const GeometryRef& geometryRef : geometryRefs)
+    {
+        BrepGeometryModeler& shard = shards[geometryRef.shardIdx];
+        geometryRemaps[geometryRef.shardIdx][geometryRef.geometryIdx] = mGeometries.size();
+        mGeometries.push_back(std::move(shard.mGeometries[geometryRef.geometryIdx]));
+        mGeometryLods.push_back(std::move(shard.mGeometryLods[geometryRef.geometryIdx]));
+        mGeometryPrimitives.push_back(std::move(shard.mGeometryPrimitives[geometryRef.geometryIdx]));
+        mGeometryTypes.push_back(shard.mGeometryTypes[geometryRef.geometryIdx]);
+        mGeometryProductIndices.push_back(geometryRef.productIdx);
+    }
 
-    std::size_t solidIdx = 0;
-    for (const auto& geometryType : mGeometryTypes)
+    // Dropped geometries are redirected to the conversion of the owning shard
+    for (std::size_t shardIdx = 0; shardIdx < shards.size(); ++shardIdx)
     {
-        if (geometryType == GeometryTypeEnum::GeometryTypeSurface)
+        for (const auto& entry : shards[shardIdx].mRepresentationMapCache)
         {
-            const nlohmann::json geometry{ {"shells", {0, 1, 2, 93} } };
-            brepDoc["geometries"].push_back(geometry);
+            auto owner = mapOwners.find(entry.first);
+            if (owner == mapOwners.end())
+            {
+                continue;
+            }
+            const std::vector<std::size_t>& ownerIndices = shards[owner->second.second].mRepresentationMapCache.at(entry.first);
+            std::vector<std::size_t> mergedIndices;
+            for (std::size_t i = 0; i < entry.second.size(); ++i)
+            {
+                geometryRemaps[shardIdx][entry.second[i]] = geometryRemaps[owner->second.second][ownerIndices[i]];
+                mergedIndices.push_back(geometryRemaps[shardIdx][entry.second[i]]);
+            }
+            mRepresentationMapCache.emplace(entry.first, std::move(mergedIndices));
         }
-        else
+    }
+
+    std::vector<GeometryInstance> instances;
+    for (std::size_t shardIdx = 0; shardIdx < shards.size(); ++shardIdx)
+    {
+        for (const GeometryInstance& instance : shards[shardIdx].mInstances)
         {
-            const nlohmann::json geometry{ {"solids", solidIdx++ } };
-            brepDoc["geometries"].push_back(geometry);
+            instances.push_back({ geometryRemaps[shardIdx][instance.geometryIdx], instance.productIdx, instance.transform });
         }
     }
+    std::stable_sort(instances.begin(), instances.end(), [](const GeometryInstance& lhs, const GeometryInstance& rhs)
+        {
+            return lhs.productIdx < rhs.productIdx;
+        });
+    mInstances.insert(mInstances.end(), instances.begin(), instances.end());
 
-    for (const auto& vertex : vertices)
+    for (BrepGeometryModeler& shard : shards)
     {
-        const nlohmann::json pos{ {"position", nlohmann::json::array({ vertex.first[0], vertex.first[1], vertex.first[2] }) } };
-        brepDoc["vertices"].push_back(pos);
+        shard.mGeometries.clear();
+        shard.mGeometryLods.clear();
+        shard.mGeometryPrimitives.clear();
+        shard.mGeometryTypes.clear();
+        shard.mGeometryProductIndices.clear();
+        shard.mInstances.clear();
+        shard.mRepresentationMapCache.clear();
     }
+}
+
+void BrepGeometryModeler::setFragmentCache(const std::string& directory)
+{
+    // Everything the fragment of a product depends on besides its representation
+    std::uint64_t seed = 0;
+    seed = ProductHasher::combine(seed, mWeldTolerance);
+    seed = ProductHasher::combine(seed, mDeviationPolicy.quality());
+    seed = ProductHasher::combine(seed, mDeviationPolicy.lodCount());
+    seed = ProductHasher::combine(seed, mPrimitiveOutput);
+    mFragmentCache = std::make_shared<FragmentCache>(directory);
+    mProductHasher = std::make_shared<ProductHasher>(seed);
+}
 
-    for (std::size_t i = 0; i < edgeIndices.size(); ++i)
+bool BrepGeometryModeler::beginStream(const OdString& strBrepFilename)
+{
+    mStreamOutput = std::make_shared<BrepStreamOutput>(std::string(OdAnsiString(strBrepFilename).c_str()));
+    if (!mStreamOutput->isOpen())
     {
-        const nlohmann::json edge{ { "vertices", nlohmann::json::array({edgeIndices[i][0], edgeIndices[i][1] }) },
-                                   { "arcLength", edgeLengths[i] } };
-        brepDoc["edges"].push_back(edge);
+        mStreamOutput.reset();
+        return false;
     }
+    return true;
+}
+
+void BrepGeometryModeler::postProcessGeometries(const OdString& strBrepFilename)
+{
+    BREP_PROFILE_SCOPE("postProcessGeometries");
 
-    for (std::size_t i = 0; i < faceAreas.size(); ++i)
+    if (mStreamOutput)
     {
-        const nlohmann::json face{ {"area", faceAreas[i] } };
-        brepDoc["faces"].push_back(face);
+        // Every product is in the spill files already, only the output file is left to assemble
+        BREP_PROFILE_SCOPE("assembleStream");
+        const std::uint64_t bytesWritten = (mOutputFormat == BrepOutputFormat::Binary) ? mStreamOutput->finishBinary() : mStreamOutput->finishJson(mPrettyOutput);
+        if (bytesWritten == 0)
+        {
+            odPrintConsoleString(OD_T("Can't write BREP file %s\n"), strBrepFilename.c_str());
+        }
+        BREP_LOG(Info, "Streamed output: " << mStreamedGeometryCount << " geometries, " << mStreamOutput->bytesSpilled() << " bytes spilled");
+        Profiler::count(ProfileCounter::BytesWritten, bytesWritten);
+        mStreamOutput.reset();
+        reportTriangleBudget();
+        return;
     }
 
-    std::ofstream brepFileStream(strBrepFilename.c_str(), std::ofstream::out);
-    brepFileStream << std::setw(4) << brepDoc;
+    std::vector<OutputGeometry> outputGeometries = collectOutputGeometries();
+    PointWelder vertices(mWeldTolerance);
+    weldVertices(outputGeometries, vertices);
+
+    BrepSections sections;
+    buildTopology(vertices, outputGeometries, sections);
+    buildRecords(outputGeometries, sections);
+    Profiler::count(ProfileCounter::EdgesEmitted, sections.edgeVertices.size());
+    Profiler::count(ProfileCounter::FacesEmitted, sections.faces.size());
+    countTriangles(sections);
+    reportTriangleBudget();
+
+    if (mOutputFormat == BrepOutputFormat::Binary)
+    {
+        writeGeometriesBinary(vertices, sections, strBrepFilename);
+    }
+    else
+    {
+        writeGeometriesJson(vertices, sections, strBrepFilename);
+    }
 }
 
-void BrepGeometryModeler::postProcessTriangles(const OdArray<OdIfcStlTriangleFace>& arrTriangles, const OdString& strBrepFilename)
+std::vector<BrepGeometryModeler::OutputGeometry> BrepGeometryModeler::collectOutputGeometries() const
 {
-    OdGePoint3dMap vertices;
-    std::vector<std::array<std::size_t, 3>> triangleIndices;
-    for (const auto& triangle : arrTriangles)
+    std::vector<OutputGeometry> outputGeometries;
+    if (mStreamOutput)
     {
-        std::size_t id1 = appendPointGetIdx(vertices, triangle.m_pt1);
-        std::size_t id2 = appendPointGetIdx(vertices, triangle.m_pt2);
-        std::size_t id3 = appendPointGetIdx(vertices, triangle.m_pt3);
-
-        std::array<std::size_t, 3> arr = { id1, id2, id3 };
-        triangleIndices.push_back(arr);
+        // Streamed geometries are final once written, the levels of detail directly follow their level 0 geometry.
+        // The indices are local to the product, the fragment is offset when it is appended
+        for (std::size_t geometryIdx = 0; geometryIdx < mGeometries.size(); ++geometryIdx)
+        {
+            const std::size_t baseIdx = outputGeometries.size();
+            outputGeometries.push_back({ mGeometries[geometryIdx].get(), mGeometryPrimitives[geometryIdx].get(), mGeometryTypes[geometryIdx], 0, baseIdx });
+            for (std::size_t lodIdx = 0; lodIdx < mGeometryLods[geometryIdx].size(); ++lodIdx)
+            {
+                outputGeometries.push_back({ mGeometryLods[geometryIdx][lodIdx].get(), nullptr, mGeometryTypes[geometryIdx], static_cast<unsigned int>(lodIdx + 1), baseIdx });
+            }
+        }
+        return outputGeometries;
     }
 
-    std::cout << "vertices size = " << vertices.size() << std::endl;
-    std::cout << "triangleIndices size = " << triangleIndices.size() << std::endl;
+    // The coarser levels of detail follow all level 0 geometries, so the instances keep their geometry indices
+    for (std::size_t geometryIdx = 0; geometryIdx < mGeometries.size(); ++geometryIdx)
+    {
+        outputGeometries.push_back({ mGeometries[geometryIdx].get(), mGeometryPrimitives[geometryIdx].get(), mGeometryTypes[geometryIdx], 0, geometryIdx });
+    }
+    for (std::size_t geometryIdx = 0; geometryIdx < mGeometries.size(); ++geometryIdx)
+    {
+        for (std::size_t lodIdx = 0; lodIdx < mGeometryLods[geometryIdx].size(); ++lodIdx)
+        {
+            outputGeometries.push_back({ mGeometryLods[geometryIdx][lodIdx].get(), nullptr, mGeometryTypes[geometryIdx], static_cast<unsigned int>(lodIdx + 1), geometryIdx });
+        }
+    }
+    return outputGeometries;
+}
 
-    nlohmann::json brepDoc;
-    for (const auto& vertex : vertices)
+void BrepGeometryModeler::weldVertices(const std::vector<OutputGeometry>& outputGeometries, PointWelder& vertices)
+{
+    // Vertices are welded up front, edges and faces are then collected while walking the bodies again
+    BREP_PROFILE_SCOPE("weldVertices");
+    for (const auto& outputGeometry : outputGeometries)
     {
-        const nlohmann::json pos{ "position", nlohmann::json::array({vertex.first[0], vertex.first[1], vertex.first[2]}) };
-        brepDoc["vertices"].push_back(pos);
+        const FacetModeler::Body* body = outputGeometry.body;
+        if (body == nullptr)
+        {
+            continue;
+        }
+        FacetModeler::Vertex* vertex = body->vertexList();
+        for (std::size_t i = 0; i < body->vertexCount(); ++i, vertex = vertex->next())
+        {
+            vertices.appendPointGetIdx(vertex->point());
+        }
+        Profiler::count(ProfileCounter::PointsWelded, body->vertexCount());
     }
+    Profiler::count(ProfileCounter::VerticesEmitted, vertices.size());
+}
 
-    for (const auto& indices : triangleIndices)
+void BrepGeometryModeler::streamGeometries()
+{
+    BREP_PROFILE_SCOPE("streamGeometries");
+    BrepFragment fragment;
+    buildFragment(fragment);
+
+    // Cached fragments are self contained, their instances use the product local geometry indices
+    if (mFragmentCache && mProductHash != 0)
     {
-        const nlohmann::json ind{ "indices", nlohmann::json::array({indices[0], indices[1], indices[2]}) };
-        brepDoc["faces"].push_back(ind);
+        BrepFragment cached = fragment;
+        for (auto& instance : cached.sections.instances)
+        {
+            instance.geometryIdx -= mStreamedGeometryCount;
+        }
+        mFragmentCache->store(mProductHash, cached);
     }
+    appendFragment(fragment);
 
+    // The bodies are freed, only the geometry indices of the representation map cache outlive the product
+    mGeometries.clear();
+    mGeometryLods.clear();
+    mGeometryPrimitives.clear();
+    mGeometryTypes.clear();
+    mGeometryProductIndices.clear();
+    mInstances.clear();
+    mPendingLodCount = 0;
+}
 
-    std::ofstream brepFileStream(strBrepFilename.c_str(), std::ofstream::out);
-    brepFileStream << std::setw(4) << brepDoc;
+void BrepGeometryModeler::buildFragment(BrepFragment& fragment)
+{
+    // Vertices are welded within the product
+    std::vector<OutputGeometry> outputGeometries = collectOutputGeometries();
+    PointWelder vertices(mWeldTolerance);
+    weldVertices(outputGeometries, vertices);
+
+    buildTopology(vertices, outputGeometries, fragment.sections);
+    buildRecords(outputGeometries, fragment.sections);
+    Profiler::count(ProfileCounter::EdgesEmitted, fragment.sections.edgeVertices.size());
+    Profiler::count(ProfileCounter::FacesEmitted, fragment.sections.faces.size());
+
+    static_assert(sizeof(OdGePoint3d) == sizeof(BrepBinary::Vertex), "OdGePoint3d must match BrepBinary::Vertex");
+    const std::vector<OdGePoint3d>& points = vertices.points();
+    fragment.vertices.resize(points.size());
+    std::memcpy(fragment.vertices.data(), points.data(), points.size() * sizeof(OdGePoint3d));
 }
 
-std::size_t BrepGeometryModeler::appendPointGetIdx(OdGePoint3dMap& vertices, const OdGePoint3d& pt)
+void BrepGeometryModeler::appendFragment(BrepFragment& fragment)
 {
-    std::size_t idx = 0;
-    auto it = vertices.find(pt);
-    if (it != vertices.end())
+    BrepSections& sections = fragment.sections;
+    countTriangles(sections);
+
+    // The indices of the fragment start after the ones already written
+    BrepStreamOutput& output = *mStreamOutput;
+    const std::uint64_t geometryOffset = mStreamedGeometryCount;
+    const std::uint64_t vertexOffset = output.count(BrepBinary::kSectionVertices);
+    const std::uint64_t edgeOffset = output.count(BrepBinary::kSectionEdgeVertices);
+    const std::uint64_t faceOffset = output.count(BrepBinary::kSectionFaces);
+    const std::uint64_t faceEdgeOffset = output.count(BrepBinary::kSectionFaceEdges);
+    const std::uint64_t solidOffset = output.count(BrepBinary::kSectionSolids);
+    const std::uint64_t profilePointOffset = output.count(BrepBinary::kSectionProfilePoints);
+    for (auto& edge : sections.edgeVertices)
     {
-        idx = it->second;
+        edge.vertices[0] += vertexOffset;
+        edge.vertices[1] += vertexOffset;
     }
-    else
+    for (auto& faceEdge : sections.faceEdges)
+    {
+        faceEdge.edgeIdx += edgeOffset;
+    }
+    for (auto& face : sections.faces)
+    {
+        face.firstFaceEdge += faceEdgeOffset;
+    }
+    for (auto& geometry : sections.geometries)
+    {
+        geometry.firstEdge += edgeOffset;
+        geometry.firstFace += faceOffset;
+        geometry.solidIdx += (geometry.solidIdx != BrepBinary::kNoSolid) ? solidOffset : 0;
+    }
+    for (auto& solid : sections.solids)
+    {
+        solid += geometryOffset;
+    }
+    for (auto& lod : sections.geometryLods)
     {
-        idx = vertices.size();
-        vertices.emplace(pt, idx);
+        lod.geometryIdx += geometryOffset;
+        lod.baseGeometryIdx += geometryOffset;
+    }
+    for (auto& primitive : sections.primitives)
+    {
+        primitive.geometryIdx += geometryOffset;
+        primitive.firstProfilePoint += profilePointOffset;
     }
 
-    return idx;
+    output.append(BrepBinary::kSectionVertices, fragment.vertices.data(), fragment.vertices.size());
+    output.append(BrepBinary::kSectionEdgeVertices, sections.edgeVertices.data(), sections.edgeVertices.size());
+    output.append(BrepBinary::kSectionEdgeArcLengths, sections.edgeArcLengths.data(), sections.edgeArcLengths.size());
+    output.append(BrepBinary::kSectionFaces, sections.faces.data(), sections.faces.size());
+    output.append(BrepBinary::kSectionFaceEdges, sections.faceEdges.data(), sections.faceEdges.size());
+    output.append(BrepBinary::kSectionFaceAreas, sections.faceAreas.data(), sections.faceAreas.size());
+    output.append(BrepBinary::kSectionGeometries, sections.geometries.data(), sections.geometries.size());
+    output.append(BrepBinary::kSectionSolids, sections.solids.data(), sections.solids.size());
+    output.append(BrepBinary::kSectionInstances, sections.instances.data(), sections.instances.size());
+    output.append(BrepBinary::kSectionGeometryLods, sections.geometryLods.data(), sections.geometryLods.size());
+    output.append(BrepBinary::kSectionPrimitives, sections.primitives.data(), sections.primitives.size());
+    output.append(BrepBinary::kSectionProfilePoints, sections.profilePoints.data(), sections.profilePoints.size());
+    mStreamedGeometryCount += sections.geometries.size();
 }
 
-std::shared_ptr<FacetModeler::Body> BrepGeometryModeler::getSurfaceModel(OdIfc::OdIfcInstancePtr mappedItem)
+void BrepGeometryModeler::buildRecords(const std::vector<OutputGeometry>& outputGeometries, BrepSections& sections)
 {
-    std::vector<OdIfc::OdIfcInstancePtr> sbsmboundaries = AttributeHelper::getAttributeAsInstanceVector(mappedItem, "sbsmboundary");
-    BoundaryFaces boundaryFaces;
-    for (auto& sbsmboundary : sbsmboundaries)
+    for (const auto& instance : mInstances)
     {
-        std::vector<OdIfc::OdIfcInstancePtr> faces = AttributeHelper::getAttributeAsInstanceVector(sbsmboundary, "cfsfaces");
-        FaceBounds faceBounds;
-        for (auto& face : faces)
+        BrepBinary::Instance record;
+        record.geometryIdx = instance.geometryIdx;
+        for (int row = 0; row < 4; ++row)
         {
-            std::vector<OdIfc::OdIfcInstancePtr> bounds = AttributeHelper::getAttributeAsInstanceVector(face, "bounds");
-            BoundPolygons boundPolygons;
-            for (auto& bound : bounds)
+            for (int col = 0; col < 4; ++col)
             {
-                OdIfc::OdIfcInstancePtr boundLoop = AttributeHelper::getAttributeAsInstance(bound, "bound");
-                std::vector<OdIfc::OdIfcInstancePtr> polygons = AttributeHelper::getAttributeAsInstanceVector(boundLoop, "polygon");
-                PolygonCoordinates polygonCoordinates;
-                for (auto& polygon : polygons)
-                {
-                    polygonCoordinates.push_back(AttributeHelper::getVector<OdGeVector3d>(polygon, "coordinates"));
-                }
-                boundPolygons.push_back(polygonCoordinates);
+                record.transform[row * 4 + col] = instance.transform[row][col];
             }
-            faceBounds.push_back(boundPolygons);
         }
-        boundaryFaces.push_back(faceBounds);
+        sections.instances.push_back(record);
     }
 
-    OdGePoint3dMap vertices;
-    std::vector<std::array<std::size_t, 3>> triangleIndices;
-    std::cout << "printing mapped surface" << std::endl;
-    std::cout << "\tlength of boundaryFaces: " << boundaryFaces.size() << std::endl;
-
-    // Fill in the Point3d map in order to prevent duplications
-    // And use map indices as triangle indices
-    for (const FaceBounds& boundaryFace : boundaryFaces)
+    for (std::size_t geometryIdx = 0; geometryIdx < outputGeometries.size(); ++geometryIdx)
     {
-        for (const BoundPolygons& boundPolygon : boundaryFace)
+        if (outputGeometries[geometryIdx].lod != 0)
+        {
+            sections.geometryLods.push_back({ geometryIdx, outputGeometries[geometryIdx].baseIdx, outputGeometries[geometryIdx].lod, 0u });
+        }
+
+        const ExtrusionPrimitive* primitive = outputGeometries[geometryIdx].primitive;
+        if (primitive == nullptr)
+        {
+            continue;
+        }
+        BrepBinary::Primitive record;
+        record.geometryIdx = geometryIdx;
+        record.type = primitive->polygon.empty() ? BrepBinary::kPrimitiveCylinder : BrepBinary::kPrimitivePolygonExtrusion;
+        record.reserved = 0;
+        for (int row = 0; row < 4; ++row)
         {
-            for (const PolygonCoordinates& polyCoords : boundPolygon)
+            for (int col = 0; col < 4; ++col)
             {
-                std::size_t id1 = appendPointGetIdx(vertices, polyCoords[0].asPoint());
-                std::size_t id2 = appendPointGetIdx(vertices, polyCoords[1].asPoint());
-                std::size_t id3 = appendPointGetIdx(vertices, polyCoords[2].asPoint());
-                std::array<std::size_t, 3> arr = { id1, id2, id3 };
-                triangleIndices.push_back(arr);
+                record.placement[row * 4 + col] = primitive->placement[row][col];
             }
         }
+        record.extrusion[0] = primitive->extrusion.x;
+        record.extrusion[1] = primitive->extrusion.y;
+        record.extrusion[2] = primitive->extrusion.z;
+        record.radius = primitive->radius;
+        record.firstProfilePoint = sections.profilePoints.size();
+        record.profilePointCount = primitive->polygon.size();
+        for (const OdGePoint2d& pt : primitive->polygon)
+        {
+            sections.profilePoints.push_back({ { pt.x, pt.y } });
+        }
+        sections.primitives.push_back(record);
     }
+}
 
-    std::vector<OdGePoint3d> verticesVector(vertices.size());
-    for (const auto& vertex : vertices)
+void BrepGeometryModeler::countTriangles(const BrepSections& sections)
+{
+    // Triangles of the level 0 geometries as converted and as placed by the instances, and of every coarser level.
+    // Levels of detail are numbered by the geometry indices of sections, instances by the output indices
+    std::vector<unsigned int> levels(sections.geometries.size(), 0);
+    for (const auto& lod : sections.geometryLods)
+    {
+        levels[static_cast<std::size_t>(lod.geometryIdx)] = lod.level;
+    }
+    mTriangleBudget.lodTriangles.resize(mDeviationPolicy.lodCount(), 0);
+    for (std::size_t i = 0; i < sections.geometries.size(); ++i)
+    {
+        mOutputTriangles.push_back(sections.geometryTriangles[i]);
+        if (levels[i] < mTriangleBudget.lodTriangles.size())
+        {
+            mTriangleBudget.lodTriangles[levels[i]] += sections.geometryTriangles[i];
+        }
+    }
+    for (const auto& instance : sections.instances)
     {
-        verticesVector[vertex.second] = vertex.first;
+        mTriangleBudget.instancedTriangles += mOutputTriangles[static_cast<std::size_t>(instance.geometryIdx)];
     }
+}
 
-    std::vector<OdInt32> faceData;
-    for (const auto& indices : triangleIndices)
+void BrepGeometryModeler::reportTriangleBudget()
+{
+    const std::uint64_t triangles = mTriangleBudget.lodTriangles.empty() ? 0 : mTriangleBudget.lodTriangles.front();
+    Profiler::count(ProfileCounter::Triangles, triangles);
+    Profiler::count(ProfileCounter::InstancedTriangles, mTriangleBudget.instancedTriangles);
+    BREP_LOG(Info, "Triangle budget: " << triangles << " triangles, " << mTriangleBudget.instancedTriangles << " instanced");
+    for (std::size_t lod = 1; lod < mTriangleBudget.lodTriangles.size(); ++lod)
     {
-        faceData.push_back(3);
-        faceData.push_back(indices[0]);
-        faceData.push_back(indices[1]);
-        faceData.push_back(indices[2]);
+        BREP_LOG(Info, "\tlevel of detail " << lod << ": " << mTriangleBudget.lodTriangles[lod] << " triangles of solids");
     }
+}
+
+void BrepGeometryModeler::buildTopology(const PointWelder& vertices, const std::vector<OutputGeometry>& outputGeometries, BrepSections& topology)
+{
+    BREP_PROFILE_SCOPE("buildTopology");
+
+    // Welded vertex pair, smaller index first, of an edge of the current geometry
+    struct EdgeKey
+    {
+        std::uint64_t lo;
+        std::uint64_t hi;
+
+        bool operator==(const EdgeKey& rhs) const { return lo == rhs.lo && hi == rhs.hi; }
+    };
+    struct EdgeKeyHash
+    {
+        std::size_t operator()(const EdgeKey& key) const
+        {
+            std::uint64_t h = key.lo * 0x9E3779B97F4A7C15ull ^ key.hi * 0xC2B2AE3D27D4EB4Full;
+            h ^= h >> 31;
+            return static_cast<std::size_t>(h);
+        }
+    };
+    std::unordered_map<EdgeKey, std::uint64_t, EdgeKeyHash> geometryEdges;
 
-    if(0)
+    topology.geometries.resize(outputGeometries.size());
+    topology.geometryTriangles.assign(outputGeometries.size(), 0);
+    for (std::size_t geometryIdx = 0; geometryIdx < outputGeometries.size(); ++geometryIdx)
     {
-        std::vector<OdGePoint3d> aVertices{
-      OdGePoint3d(77.0, 0.0,  0.0),
-      OdGePoint3d(0.0,  70.0, 0.0),
-      OdGePoint3d(77.0, 77.0, 0.0),
-      OdGePoint3d(0.0,  77.0, 77.0),
-        };
+        const FacetModeler::Body* body = outputGeometries[geometryIdx].body;
+        BrepBinary::Geometry& geometry = topology.geometries[geometryIdx];
+        geometry.reserved = 0;
+        geometry.firstEdge = topology.edgeVertices.size();
+        geometry.firstFace = topology.faces.size();
+        geometry.edgeCount = 0;
+        geometry.faceCount = 0;
+        if (outputGeometries[geometryIdx].type == GeometryTypeEnum::GeometryTypePrimitive)
+        {
+            // No facets, the primitive record describes it
+            geometry.type = BrepBinary::kGeometryPrimitive;
+            geometry.solidIdx = BrepBinary::kNoSolid;
+            continue;
+        }
+        else if (outputGeometries[geometryIdx].type == GeometryTypeEnum::GeometryTypeSolid)
+        {
+            geometry.type = BrepBinary::kGeometrySolid;
+            geometry.solidIdx = topology.solids.size();
+            topology.solids.push_back(geometryIdx);
+        }
+        else
+        {
+            geometry.type = BrepBinary::kGeometrySurface;
+            geometry.solidIdx = BrepBinary::kNoSolid;
+        }
+
+        // Edges are shared within a geometry only, the geometries stay independent of each other
+        geometryEdges.clear();
+        geometryEdges.reserve(body->vertexCount() * 3);
+
+        FacetModeler::Face* face = body->faceList();
+        for (std::size_t i = 0; i < body->faceCount(); ++i, face = face->next())
+        {
+            topology.faces.push_back({ topology.faceEdges.size(), face->loopEdgeCount() });
+            topology.faceAreas.push_back(face->area());
+            topology.geometryTriangles[geometryIdx] += (face->loopEdgeCount() > 2) ? face->loopEdgeCount() - 2 : 0;
+
+            FacetModeler::Edge* edge = face->edge();
+            for (std::size_t j = 0; j < face->loopEdgeCount(); ++j, edge = edge->next())
+            {
+                const std::uint64_t start = vertices.find(edge->startPoint());
+                const std::uint64_t end = vertices.find(edge->endPoint());
+                const EdgeKey key = { std::min(start, end), std::max(start, end) };
+
+                auto inserted = geometryEdges.emplace(key, topology.edgeVertices.size());
+                if (inserted.second)
+                {
+                    topology.edgeVertices.push_back({ { start, end } });
+                    topology.edgeArcLengths.push_back(edge->length());
+                }
+
+                const std::uint64_t edgeIdx = inserted.first->second;
+                const bool reversed = topology.edgeVertices[edgeIdx].vertices[0] != start;
+                topology.faceEdges.push_back({ edgeIdx, reversed ? 1u : 0u, 0u });
+            }
+        }
 
-        // Create array with face data
-        std::vector<OdInt32> aFaceData{
-          3, 3, 2, 1,
-          3, 1, 2, 0,
-          3, 2, 3, 0,
-          3, 3, 1, 0,
-        };
-        auto bd = FacetModeler::Body::createFromMesh(aVertices, aFaceData);
-        std::cout << "\tbd.faceCount = " << bd.faceCount() << std::endl;
+        geometry.edgeCount = topology.edgeVertices.size() - geometry.firstEdge;
+        geometry.faceCount = topology.faces.size() - geometry.firstFace;
     }
+}
+
+void BrepGeometryModeler::writeGeometriesJson(const PointWelder& vertices, const BrepSections& sections, const OdString& strBrepFilename)
+{
+    BREP_PROFILE_SCOPE("writeJson");
+    const std::vector<OdGePoint3d>& points = vertices.points();
+    BrepJsonRenderer::MemorySource vertexSource(reinterpret_cast<const BrepBinary::Vertex*>(points.data()), points.size());
+    BrepJsonRenderer::MemorySource edgeVertices(sections.edgeVertices.data(), sections.edgeVertices.size());
+    BrepJsonRenderer::MemorySource edgeArcLengths(sections.edgeArcLengths.data(), sections.edgeArcLengths.size());
+    BrepJsonRenderer::MemorySource faces(sections.faces.data(), sections.faces.size());
+    BrepJsonRenderer::MemorySource faceEdges(sections.faceEdges.data(), sections.faceEdges.size());
+    BrepJsonRenderer::MemorySource faceAreas(sections.faceAreas.data(), sections.faceAreas.size());
+    BrepJsonRenderer::MemorySource geometries(sections.geometries.data(), sections.geometries.size());
+    BrepJsonRenderer::MemorySource geometryLods(sections.geometryLods.data(), sections.geometryLods.size());
+    BrepJsonRenderer::MemorySource primitives(sections.primitives.data(), sections.primitives.size());
+    BrepJsonRenderer::MemorySource profilePoints(sections.profilePoints.data(), sections.profilePoints.size());
+    BrepJsonRenderer::MemorySource instances(sections.instances.data(), sections.instances.size());
+    const BrepJsonRenderer::Sections sources = {
+        &vertexSource, &edgeVertices, &edgeArcLengths, &faces, &faceEdges, &faceAreas,
+        &geometries, &geometryLods, &primitives, &profilePoints, &instances
+    };
+
+    std::ofstream brepFileStream(strBrepFilename.c_str(), std::ofstream::out);
+    BrepJsonWriter writer(brepFileStream, mPrettyOutput);
+    BrepJsonRenderer::render(writer, sources);
+    writer.flush();
+    Profiler::count(ProfileCounter::BytesWritten, writer.bytesWritten());
+}
+
+void BrepGeometryModeler::writeGeometriesBinary(const PointWelder& vertices, const BrepSections& sections, const OdString& strBrepFilename)
+{
+    BREP_PROFILE_SCOPE("writeBinary");
+    // OdGePoint3d is three packed doubles, the welded points are written as they are
+    static_assert(sizeof(OdGePoint3d) == sizeof(BrepBinary::Vertex), "OdGePoint3d must match BrepBinary::Vertex");
+    const std::vector<OdGePoint3d>& points = vertices.points();
 
-    /* Don't dump --> int n = 0;
-    for (const auto& v : verticesVector)
+    // Every section is an array of its own, so it goes to the file with a single write
+    BrepBinaryWriter writer;
+    writer.addSection(BrepBinary::kSectionVertices, reinterpret_cast<const BrepBinary::Vertex*>(points.data()), points.size());
+    writer.addSection(BrepBinary::kSectionEdgeVertices, sections.edgeVertices.data(), sections.edgeVertices.size());
+    writer.addSection(BrepBinary::kSectionEdgeArcLengths, sections.edgeArcLengths.data(), sections.edgeArcLengths.size());
+    writer.addSection(BrepBinary::kSectionFaces, sections.faces.data(), sections.faces.size());
+    writer.addSection(BrepBinary::kSectionFaceEdges, sections.faceEdges.data(), sections.faceEdges.size());
+    writer.addSection(BrepBinary::kSectionFaceAreas, sections.faceAreas.data(), sections.faceAreas.size());
+    writer.addSection(BrepBinary::kSectionGeometries, sections.geometries.data(), sections.geometries.size());
+    writer.addSection(BrepBinary::kSectionSolids, sections.solids.data(), sections.solids.size());
+    writer.addSection(BrepBinary::kSectionInstances, sections.instances.data(), sections.instances.size());
+    writer.addSection(BrepBinary::kSectionGeometryLods, sections.geometryLods.data(), sections.geometryLods.size());
+    writer.addSection(BrepBinary::kSectionPrimitives, sections.primitives.data(), sections.primitives.size());
+    writer.addSection(BrepBinary::kSectionProfilePoints, sections.profilePoints.data(), sections.profilePoints.size());
+
+    std::ofstream brepFileStream(strBrepFilename.c_str(), std::ofstream::out | std::ofstream::binary);
+    if (!writer.write(brepFileStream))
     {
-        std::cout << n++ << " : " << v[0] << ", " << v[1] << ", " << v[2] << std::endl;
+        odPrintConsoleString(OD_T("Can't write binary BREP file %s\n"), strBrepFilename.c_str());
     }
-    for (std::size_t i = 0; i < faceData.size(); ++i)
+    Profiler::count(ProfileCounter::BytesWritten, static_cast<std::uint64_t>(brepFileStream.tellp()));
+}
+
+void BrepGeometryModeler::postProcessTriangles(const TriangleCapture& capture, const OdString& strBrepFilename)
+{
+    BREP_PROFILE_SCOPE("postProcessTriangles");
+
+    // Captured vertex -> welded vertex
+    PointWelder vertices(mWeldTolerance);
+    vertices.reserve(capture.vertices().size());
+    std::vector<std::uint64_t> vertexIndices;
+    vertexIndices.reserve(capture.vertices().size());
+    for (const auto& vertex : capture.vertices())
     {
-        std::cout << faceData[i];
-        if (i % 4 == 3)
+        vertexIndices.push_back(vertices.appendPointGetIdx(vertex));
+    }
+
+    Profiler::count(ProfileCounter::PointsWelded, capture.vertices().size());
+    Profiler::count(ProfileCounter::VerticesEmitted, vertices.size());
+    Profiler::count(ProfileCounter::FacesEmitted, capture.triangleCount());
+    Profiler::count(ProfileCounter::Triangles, capture.triangleCount());
+    BREP_LOG(Info, "vertices size = " << vertices.size());
+    BREP_LOG(Info, "triangleIndices size = " << capture.triangleCount());
+
+    std::ofstream brepFileStream(strBrepFilename.c_str(), std::ofstream::out);
+    BrepJsonWriter writer(brepFileStream, mPrettyOutput);
+    writer.beginObject();
+
+    writer.beginArray("vertices");
+    for (const auto& vertex : vertices.points())
+    {
+        writer.beginObject();
+        writer.beginArray("position");
+        writer.value(vertex[0]);
+        writer.value(vertex[1]);
+        writer.value(vertex[2]);
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.beginArray("faces");
+    for (const auto& product : capture.products())
+    {
+        const std::uint32_t* indices = capture.indices().data() + product.firstIndex;
+        for (std::size_t i = 0; i < product.indexCount; i += 3)
         {
-            std::cout << std::endl;
+            writer.beginObject();
+            writer.beginArray("indices");
+            writer.value(vertexIndices[product.firstVertex + indices[i]]);
+            writer.value(vertexIndices[product.firstVertex + indices[i + 1]]);
+            writer.value(vertexIndices[product.firstVertex + indices[i + 2]]);
+            writer.endArray();
+            writer.endObject();
         }
-        else
+    }
+    writer.endArray();
+
+    // Faces of every product, in face order
+    writer.beginArray("products");
+    std::uint64_t firstFace = 0;
+    for (const auto& product : capture.products())
+    {
+        writer.beginObject();
+        writer.value("handle", static_cast<std::uint64_t>(product.handle));
+        writer.value("firstFace", firstFace);
+        writer.value("faceCount", static_cast<std::uint64_t>(product.indexCount / 3));
+        writer.endObject();
+        firstFace += product.indexCount / 3;
+    }
+    writer.endArray();
+
+    writer.endObject();
+    writer.flush();
+    Profiler::count(ProfileCounter::BytesWritten, writer.bytesWritten());
+}
+
+std::shared_ptr<FacetModeler::Body> BrepGeometryModeler::getSurfaceModel(OdIfc::OdIfcInstancePtr mappedItem)
+{
+    BREP_PROFILE_SCOPE("getSurfaceModel");
+    static const OdIfc::OdIfcAttribute kSbsmBoundary = AttributeHelper::attributeKey("sbsmboundary");
+    static const OdIfc::OdIfcAttribute kCfsFaces = AttributeHelper::attributeKey("cfsfaces");
+    static const OdIfc::OdIfcAttribute kBounds = AttributeHelper::attributeKey("bounds");
+    static const OdIfc::OdIfcAttribute kBound = AttributeHelper::attributeKey("bound");
+    // SET OF IfcShell, a SELECT of IfcOpenShell and IfcClosedShell
+    AttributeHelper::InstanceRange sbsmboundaries = AttributeHelper::getSelectAttributeAsInstanceRange(mappedItem, kSbsmBoundary);
+
+    // The faces of the shells are only opened one at a time while they are meshed
+    ScratchVector<AttributeHelper::InstanceRange> shells;
+    std::size_t faceCount = 0;
+    for (auto sbsmboundary : sbsmboundaries)
+    {
+        shells.push_back(AttributeHelper::getAttributeAsInstanceRange(sbsmboundary, kCfsFaces));
+        faceCount += shells.back().size();
+    }
+
+    // Faces are mostly triangles: 3 points and 4 face data entries per face.
+    // The welded points and the face data are handed to FacetModeler as std::vectors and always come from the heap,
+    // they are counted with the heap allocations of the scratch temporaries whenever their capacity changes
+    PointWelder vertices(mWeldTolerance);
+    vertices.reserve(faceCount * 3);
+    std::vector<OdInt32> faceData;
+    faceData.reserve(faceCount * 4);
+    std::size_t pointCapacity = vertices.points().capacity();
+    std::size_t faceDataCapacity = faceData.capacity();
+    Profiler::count(ProfileCounter::ScratchHeapAllocations, (pointCapacity != 0 ? 1 : 0) + (faceDataCapacity != 0 ? 1 : 0));
+
+    // Every IfcFace becomes a face of the mesh: the outer bound, followed by the other bounds as holes (negative
+    // point counts, as in a shell face list). The points are welded into vertex indices on the way
+    struct Loop
+    {
+        std::size_t first;
+        std::size_t count;
+    };
+    ScratchVector<OdGePoint3d> loopPoints;
+    ScratchVector<Loop> loops;
+    for (const auto& shellFaces : shells)
+    {
+        for (auto face : shellFaces)
         {
-            std::cout << ", ";
+            loopPoints.clear();
+            loops.clear();
+            std::size_t outerLoopIdx = 0;
+            bool bOuterBound = false;
+            for (auto bound : AttributeHelper::getAttributeAsInstanceRange(face, kBounds))
+            {
+                OdIfc::OdIfcInstancePtr boundLoop = AttributeHelper::getAttributeAsInstance(bound, kBound);
+                const std::size_t first = loopPoints.size();
+                AttributeHelper::getPolygonPoints(boundLoop, loopPoints);
+                if (loopPoints.size() - first < 3)
+                {
+                    loopPoints.resize(first);
+                    continue;
+                }
+
+                // Without an IfcFaceOuterBound the first bound is the outer one
+                if (!bOuterBound && bound->isKindOf(OdIfc::kIfcFaceOuterBound))
+                {
+                    outerLoopIdx = loops.size();
+                    bOuterBound = true;
+                }
+                loops.push_back({ first, loopPoints.size() - first });
+            }
+            if (loops.empty())
+            {
+                continue;
+            }
+
+            std::swap(loops[0], loops[outerLoopIdx]);
+            for (std::size_t loopIdx = 0; loopIdx < loops.size(); ++loopIdx)
+            {
+                const Loop& loop = loops[loopIdx];
+                const OdInt32 count = static_cast<OdInt32>(loop.count);
+                faceData.push_back(loopIdx == 0 ? count : -count);
+                for (std::size_t pointIdx = loop.first; pointIdx < loop.first + loop.count; ++pointIdx)
+                {
+                    faceData.push_back(static_cast<OdInt32>(vertices.appendPointGetIdx(loopPoints[pointIdx])));
+                }
+            }
+
+            if (vertices.points().capacity() != pointCapacity || faceData.capacity() != faceDataCapacity)
+            {
+                Profiler::count(ProfileCounter::ScratchHeapAllocations, (vertices.points().capacity() != pointCapacity ? 1 : 0) + (faceData.capacity() != faceDataCapacity ? 1 : 0));
+                pointCapacity = vertices.points().capacity();
+                faceDataCapacity = faceData.capacity();
+            }
         }
-    }*/
-    auto surfaceFromFile = FacetModeler::Body::createFromMesh(verticesVector, faceData);
-    std::cout << "\tsurfaceFromFile .faceCount = " << surfaceFromFile.faceCount() << std::endl;
-    std::cout << std::endl;
-    std::cout << std::endl;
+    }
+
+    std::shared_ptr<FacetModeler::Body> body;
+    {
+        BREP_PROFILE_SCOPE("createFromMesh");
+        body = std::make_shared<FacetModeler::Body>(FacetModeler::Body::createFromMesh(vertices.points(), faceData));
+    }
+
+    BREP_LOG(Debug, "printing mapped surface");
+    BREP_LOG(Debug, "\tlength of boundaryFaces: " << sbsmboundaries.size());
+    BREP_LOG(Debug, "\tsurfaceFromFile .faceCount = " << body->faceCount());
 
-    return std::make_shared<FacetModeler::Body>(FacetModeler::Body::createFromMesh(verticesVector, faceData));
+    return body;
 }
 
-std::shared_ptr<FacetModeler::Body> BrepGeometryModeler::getSweptSolid(OdIfc::OdIfcInstancePtr mappedItem)
+OdGeMatrix3d BrepGeometryModeler::getExtrusionPlacement(OdIfc::OdIfcInstancePtr sweptSolid)
 {
-    std::cout << "printing mapped solid" << std::endl;
-    // Base circle
-    OdIfc::OdIfcInstancePtr sweptarea = AttributeHelper::getAttributeAsInstance(mappedItem, "sweptarea");
-    OdIfc::OdIfcInstancePtr sweptareaPosition = AttributeHelper::getAttributeAsInstance(sweptarea, "position");
-    double r = AttributeHelper::getDouble(sweptarea, "radius");
-    OdGeVector2d locationCircleCoord = AttributeHelper::getVector<OdGeVector2d>(sweptareaPosition, "location", "coordinates");
-    OdGeVector2d directionratiosrefDirCircle = AttributeHelper::getVector<OdGeVector2d>(sweptareaPosition, "refdirection", "directionratios");
-    std::cout << "\tradius = " << r << std::endl;
-    std::cout << "\tlocation: " << locationCircleCoord.x << " , " << locationCircleCoord.y << std::endl;
-    std::cout << "\tdirection: " << directionratiosrefDirCircle.x << " , " << directionratiosrefDirCircle.y << std::endl;
-
-    // Solid Cylinder
-    double depth = AttributeHelper::getDouble(mappedItem, "depth");
-    OdGeVector3d dir = AttributeHelper::getVector<OdGeVector3d>(mappedItem, "extrudeddirection", "directionratios");
-    OdIfc::OdIfcInstancePtr position = AttributeHelper::getAttributeAsInstance(mappedItem, "position");
+    // IfcAxis2Placement3D, axis is z and refdirection x, they default to the global axes
+    OdIfc::OdIfcInstancePtr position = AttributeHelper::getAttributeAsInstance(sweptSolid, "position");
     OdGeVector3d center = AttributeHelper::getVector<OdGeVector3d>(position, "location", "coordinates");
     OdGeVector3d z_axis = AttributeHelper::getVector<OdGeVector3d>(position, "axis", "directionratios");
-    OdGeVector3d y_axis = AttributeHelper::getVector<OdGeVector3d>(position, "refdirection", "directionratios");
-    OdGeVector3d x_axis = z_axis.crossProduct(y_axis);
-    OdGeMatrix3d rotation = OdGeMatrix3d();
-    rotation.setCoordSystem(center.asPoint(), x_axis, y_axis, z_axis);
-
-    std::cout << "\tdepth: " << depth << std::endl;
-    std::cout << "\text.dir: " << dir.x << " , " << dir.y << " , " << dir.z << std::endl;
-    std::cout << "\tcenter: " << center.x << " , " << center.y << " , " << center.z << std::endl;
-    std::cout << "\tx_axis: " << x_axis.x << " , " << x_axis.y << " , " << x_axis.z << std::endl;
-    std::cout << "\ty_axis: " << y_axis.x << " , " << y_axis.y << " , " << y_axis.z << std::endl;
-    std::cout << "\tz_axis: " << z_axis.x << " , " << z_axis.y << " , " << z_axis.z << std::endl;
-    std::cout << std::endl;
-
-    FacetModeler::DeviationParams devParams;
-    std::shared_ptr<FacetModeler::Body> body = createCylinder(
-        devParams,
-        locationCircleCoord.asPoint(),
-        directionratiosrefDirCircle,
-        r,
-        dir,
-        depth,
-        rotation);
+    OdGeVector3d refdirection = AttributeHelper::getVector<OdGeVector3d>(position, "refdirection", "directionratios");
+    z_axis = z_axis.isZeroLength() ? OdGeVector3d::kZAxis : z_axis.normal();
+    if (refdirection.isZeroLength() || refdirection.isParallelTo(z_axis))
+    {
+        refdirection = z_axis.perpVector();
+    }
+    OdGeVector3d x_axis = (refdirection - z_axis * refdirection.dotProduct(z_axis)).normal();
+    OdGeVector3d y_axis = z_axis.crossProduct(x_axis);
+    OdGeMatrix3d placement = OdGeMatrix3d();
+    placement.setCoordSystem(center.asPoint(), x_axis, y_axis, z_axis);
 
-    return body;
+    BREP_LOG(Debug, "\tcenter: " << center.x << " , " << center.y << " , " << center.z);
+    BREP_LOG(Debug, "\tx_axis: " << x_axis.x << " , " << x_axis.y << " , " << x_axis.z);
+    BREP_LOG(Debug, "\ty_axis: " << y_axis.x << " , " << y_axis.y << " , " << y_axis.z);
+    BREP_LOG(Debug, "\tz_axis: " << z_axis.x << " , " << z_axis.y << " , " << z_axis.z);
+    return placement;
 }
 
-std::shared_ptr<FacetModeler::Body> BrepGeometryModeler::createCylinder(const FacetModeler::DeviationParams& devDeviation, const OdGePoint2d& baseLocation, const OdGeVector2d& baseDirection, double radius, const OdGeVector3d& extrusionDirection, double height, const OdGeMatrix3d& rotation)
+std::shared_ptr<const BrepGeometryModeler::ExtrusionPrimitive> BrepGeometryModeler::getExtrusionPrimitive(OdIfc::OdIfcInstancePtr sweptSolid)
 {
-    FacetModeler::Profile2D cBase;            // Create base profile
-    cBase.resize(1);                          // With one contour
+    BREP_PROFILE_SCOPE("getExtrusionPrimitive");
+    OdIfc::OdIfcInstancePtr sweptarea = AttributeHelper::getAttributeAsInstance(sweptSolid, "sweptarea");
+    const ProfileCache::Entry* profile = mProfileCache.get(sweptarea);
+    if (profile == nullptr || profile->shape == ProfileCache::Shape::Other)
+    {
+        return nullptr;
+    }
 
-    cBase.front().appendVertex(baseLocation - baseDirection * radius, 1);
-    cBase.front().appendVertex(baseLocation + baseDirection * radius, 1);
+    BREP_LOG(Debug, "printing solid primitive");
+    auto primitive = std::make_shared<ExtrusionPrimitive>();
+    const double depth = AttributeHelper::getDouble(sweptSolid, "depth");
+    primitive->extrusion = AttributeHelper::getVector<OdGeVector3d>(sweptSolid, "extrudeddirection", "directionratios") * depth;
+    primitive->placement = getExtrusionPlacement(sweptSolid);
+    if (profile->shape == ProfileCache::Shape::Circle)
+    {
+        // The circle is moved to the origin of the placement
+        primitive->placement *= OdGeMatrix3d::translation(OdGeVector3d(profile->center.x, profile->center.y, 0.0));
+        primitive->radius = profile->radius;
+    }
+    else
+    {
+        primitive->radius = 0.0;
+        primitive->polygon = profile->polygon;
+    }
+    return primitive;
+}
+
+std::vector<std::shared_ptr<FacetModeler::Body>> BrepGeometryModeler::getSweptSolid(OdIfc::OdIfcInstancePtr mappedItem)
+{
+    BREP_PROFILE_SCOPE("getSweptSolid");
+    BREP_LOG(Debug, "printing mapped solid");
+    // Base profile, built once per IfcProfileDef
+    OdIfc::OdIfcInstancePtr sweptarea = AttributeHelper::getAttributeAsInstance(mappedItem, "sweptarea");
+    const ProfileCache::Entry* profile = mProfileCache.get(sweptarea);
+    BREP_LOG(Debug, "\tprofile: " << profile->profile.size() << " contours, radius = " << profile->radius);
 
-    cBase.front().setOrientationAt(0, FacetModeler::efoFront);
-    cBase.front().setOrientationAt(1, FacetModeler::efoFront);
+    double depth = AttributeHelper::getDouble(mappedItem, "depth");
+    OdGeVector3d dir = AttributeHelper::getVector<OdGeVector3d>(mappedItem, "extrudeddirection", "directionratios");
+    OdGeMatrix3d rotation = getExtrusionPlacement(mappedItem);
 
-    cBase.front().setClosed();                // Close profile
-    cBase.front().makeCCW();                  // Make contour outer
+    BREP_LOG(Debug, "\tdepth: " << depth);
+    BREP_LOG(Debug, "\text.dir: " << dir.x << " , " << dir.y << " , " << dir.z);
 
-    return std::make_shared< FacetModeler::Body>(FacetModeler::Body::extrusion(cBase, rotation, extrusionDirection * height, devDeviation));
+    // Level 0 first, each further level doubles the deviation
+    std::vector<std::shared_ptr<FacetModeler::Body>> lods;
+    for (unsigned int lod = 0; lod < mDeviationPolicy.lodCount(); ++lod)
+    {
+        lods.push_back(createExtrusion(
+            mDeviationPolicy.sweptSolid(profile->radius, lod),
+            profile->profile,
+            dir,
+            depth,
+            rotation));
+    }
+    return lods;
+}
+
+std::shared_ptr<FacetModeler::Body> BrepGeometryModeler::createCylinder(const FacetModeler::DeviationParams& devDeviation, const OdGePoint2d& baseLocation, const OdGeVector2d& baseDirection, double radius, const OdGeVector3d& extrusionDirection, double height, const OdGeMatrix3d& rotation)
+{
+    FacetModeler::Profile2D cBase;            // Create base profile
+    ProfileCache::appendCircle(cBase, baseLocation, baseDirection, radius);
+    return createExtrusion(devDeviation, cBase, extrusionDirection, height, rotation);
+}
+
+std::shared_ptr<FacetModeler::Body> BrepGeometryModeler::createExtrusion(const FacetModeler::DeviationParams& devDeviation, const FacetModeler::Profile2D& base, const OdGeVector3d& extrusionDirection, double height, const OdGeMatrix3d& rotation)
+{
+    BREP_PROFILE_SCOPE("extrusion");
+    return std::make_shared< FacetModeler::Body>(FacetModeler::Body::extrusion(base, rotation, extrusionDirection * height, devDeviation));
 }
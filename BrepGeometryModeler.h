@@ -16,54 +16,192 @@
 #include "FMDataSerialize.h"
 #include "Modeler/FMMdlIterators.h"
 
-#include <array>
+#include "PointWelder.h"
+#include "BrepJsonWriter.h"
+#include "BrepBinaryWriter.h"
+#include "BrepJsonRenderer.h"
+#include "BrepStreamOutput.h"
+#include "DeviationPolicy.h"
+#include "FragmentCache.h"
+#include "ProductHasher.h"
+#include "ProfileCache.h"
+#include "TriangleCapture.h"
+
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <fstream>
-#include <iomanip>
+#include <limits>
+#include <map>
+#include <unordered_map>
 #include <vector>
-#include <json/single_include/nlohmann/json.hpp>
 
 enum class GeometryTypeEnum
 {
     GeometryTypeSurface,
-    GeometryTypeSolid
+    GeometryTypeSolid,
+    GeometryTypePrimitive       // analytic extrusion, not tessellated
+};
+
+enum class BrepOutputFormat
+{
+    Json,
+    Binary      // memory mappable layout of BrepBinaryFormat.h
 };
 
 class BrepGeometryModeler
 {
+    // Times the private conversion steps in isolation
+    friend class BrepGeometryModelerBenchmark;
+
 public:
 	BrepGeometryModeler() = default;
 	~BrepGeometryModeler() = default;
 
+    // Converts the items of the body representations of an IfcProduct, IfcMappedItems are resolved to their mapped representation.
+    // productIdx is the position of the product in the selection, it orders the geometries when shards are merged
+    void addProduct(OdIfc::OdIfcInstancePtr product, std::size_t productIdx = 0);
+
+    // Dispatches a representation item by type: IfcShellBasedSurfaceModel as surface, IfcExtrudedAreaSolid with a profile
+    // supported by ProfileCache as solid, other items are skipped. Returns false if no geometry was added
+    bool addItem(OdIfc::OdIfcInstancePtr item);
+
+    // Converts the items of the mapped representation once per IfcRepresentationMap and deviation policy,
+    // every IfcMappedItem then only adds an instance of them with its mapping transform
+    void addMappedItem(OdIfc::OdIfcInstancePtr mappedItem);
+
 	void addMappedItemAsSurface(OdIfc::OdIfcInstancePtr mappedItem);
 	void addMappedItemAsSolid(OdIfc::OdIfcInstancePtr mappedItem);
 
+    // Empty modeler with the same conversion settings, to be filled by a worker and merged back with mergeShards
+    BrepGeometryModeler createShard() const;
+
+    // Moves the geometries of the shards into this modeler, ordered by product index and then by conversion order,
+    // so the result doesn't depend on which shard converted which product
+    void mergeShards(std::vector<BrepGeometryModeler>& shards);
+
+    // Points closer than the tolerance are merged into one vertex, 0 merges only identical points
+    void setWeldTolerance(double tolerance) { mWeldTolerance = tolerance; }
+
+    // Compact JSON by default, indented by 4 when pretty
+    void setPrettyOutput(bool pretty) { mPrettyOutput = pretty; }
+
+    void setOutputFormat(BrepOutputFormat format) { mOutputFormat = format; }
+
+    // Tessellation quality and levels of detail of the swept solids
+    void setDeviationPolicy(const DeviationPolicy& policy) { mDeviationPolicy = policy; }
+
+    // Writes extrusions of single circles and polygons as analytic records instead of tessellating them
+    void setPrimitiveOutput(bool primitives) { mPrimitiveOutput = primitives; }
+
+    // Writes every product to spill files next to strBrepFilename as soon as it is converted, so the bodies of a
+    // product are freed before the next one. Vertices are welded per product. Serial conversion only.
+    bool beginStream(const OdString& strBrepFilename);
+
+    // Splices the products whose representation is unchanged from fragments cached in directory, and caches the
+    // converted ones. Requires streaming, set it after the other settings (they are part of the cache key)
+    void setFragmentCache(const std::string& directory);
+
     void postProcessGeometries(const OdString& strBrepFilename);
 
-    void postProcessTriangles(const OdArray<OdIfcStlTriangleFace>& arrTriangles, const OdString& strBrepFilename);
+    // Writes the triangles of the vectorized products, welded into one vertex list
+    void postProcessTriangles(const TriangleCapture& capture, const OdString& strBrepFilename);
 
 private:
-    using PolygonCoordinates = std::vector<OdGeVector3d>;
-    using BoundPolygons = std::vector<PolygonCoordinates>;
-    using FaceBounds = std::vector<BoundPolygons>;
-    using BoundaryFaces = std::vector<FaceBounds>;
+    // Placement of a geometry, the same geometry can be instanced any number of times
+    struct GeometryInstance
+    {
+        std::size_t geometryIdx;
+        std::size_t productIdx;
+        OdGeMatrix3d transform;
+    };
 
-    struct OdGePoint3dCompare
+    struct RepresentationMapKey
     {
-        bool operator() (const OdGePoint3d& lhs, const OdGePoint3d& rhs) const
+        OdUInt64 mapHandle;
+        double quality;
+        unsigned int lodCount;
+
+        bool operator<(const RepresentationMapKey& rhs) const
         {
-            return (lhs[0] < rhs[0]) ? true : (lhs[0] > rhs[0]) ? false :
-                (lhs[1] < rhs[1]) ? true : (lhs[1] > rhs[1]) ? false :
-                (lhs[2] < rhs[2]) ? true : false;
+            return (mapHandle != rhs.mapHandle) ? mapHandle < rhs.mapHandle :
+                (quality != rhs.quality) ? quality < rhs.quality :
+                lodCount < rhs.lodCount;
         }
     };
-    using OdGePoint3dMap = std::map<OdGePoint3d, std::size_t, OdGePoint3dCompare>;
+    // Geometry indices of the items of a mapped representation
+    using RepresentationMapCache = std::map<RepresentationMapKey, std::vector<std::size_t>>;
 
-    std::size_t appendPointGetIdx(OdGePoint3dMap& vertices, const OdGePoint3d& pt);
+    // mappingtarget * mappingorigin of an IfcMappedItem
+    OdGeMatrix3d getMappingTransform(OdIfc::OdIfcInstancePtr mappedItem, OdIfc::OdIfcInstancePtr mappingsource);
+
+    // Circle of radius around the origin, or polygon, in the xy plane of placement, swept along extrusion
+    struct ExtrusionPrimitive
+    {
+        OdGeMatrix3d placement;
+        OdGeVector3d extrusion;                 // direction times depth, in placement coordinates
+        double radius;                          // 0 for polygons
+        std::vector<OdGePoint2d> polygon;       // counterclockwise, empty for circles
+    };
+
+    // Geometry as written, level 0 geometries keep their index and the coarser levels follow all of them,
+    // streamed geometries are directly followed by their coarser levels
+    struct OutputGeometry
+    {
+        const FacetModeler::Body* body;         // nullptr for primitives
+        const ExtrusionPrimitive* primitive;
+        GeometryTypeEnum type;
+        unsigned int lod;
+        std::size_t baseIdx;    // level 0 geometry
+    };
+
+    struct TriangleBudget
+    {
+        std::vector<std::uint64_t> lodTriangles;    // per level of detail, as converted
+        std::uint64_t instancedTriangles = 0;       // level 0, as placed by the instances
+    };
+
+    // Index the next converted geometry gets in the output
+    std::size_t nextGeometryIdx() const
+    {
+        return mStreamOutput ? mStreamedGeometryCount + mGeometries.size() + mPendingLodCount : mGeometries.size();
+    }
+
+    std::vector<OutputGeometry> collectOutputGeometries() const;
+    void weldVertices(const std::vector<OutputGeometry>& outputGeometries, PointWelder& vertices);
+    void buildTopology(const PointWelder& vertices, const std::vector<OutputGeometry>& outputGeometries, BrepSections& topology);
+
+    // Instance, level of detail and primitive records
+    void buildRecords(const std::vector<OutputGeometry>& outputGeometries, BrepSections& sections);
+
+    // Appends the geometries of the current product to the stream output and frees them
+    void streamGeometries();
+    void buildFragment(BrepFragment& fragment);
+
+    // Offsets the product local indices of fragment by the elements already written and appends it
+    void appendFragment(BrepFragment& fragment);
+
+    // Returns false if the product isn't in the fragment cache
+    bool addCachedProduct(OdIfc::OdIfcInstancePtr product);
+
+    void countTriangles(const BrepSections& sections);
+
+    // Triangle counts to the profile counters and the info log
+    void reportTriangleBudget();
+
+    void writeGeometriesJson(const PointWelder& vertices, const BrepSections& sections, const OdString& strBrepFilename);
+    void writeGeometriesBinary(const PointWelder& vertices, const BrepSections& sections, const OdString& strBrepFilename);
 
     std::shared_ptr<FacetModeler::Body> getSurfaceModel(OdIfc::OdIfcInstancePtr mappedItem);
 
-	std::shared_ptr<FacetModeler::Body> getSweptSolid(OdIfc::OdIfcInstancePtr mappedItem);
+    // Placement of the position of an IfcSweptAreaSolid
+    OdGeMatrix3d getExtrusionPlacement(OdIfc::OdIfcInstancePtr sweptSolid);
+
+    // nullptr if the profile is neither a single circle nor a polygon
+    std::shared_ptr<const ExtrusionPrimitive> getExtrusionPrimitive(OdIfc::OdIfcInstancePtr sweptSolid);
+
+    // One body per level of detail of the deviation policy, level 0 first
+    std::vector<std::shared_ptr<FacetModeler::Body>> getSweptSolid(OdIfc::OdIfcInstancePtr mappedItem);
 
     std::shared_ptr<FacetModeler::Body> createCylinder(
         const FacetModeler::DeviationParams& devDeviation,
@@ -74,7 +212,35 @@ private:
         double height,
         const OdGeMatrix3d& rotation);
 
+    // Extrudes a base profile given in the coordinates of rotation, cached profiles are shared by all their extrusions
+    std::shared_ptr<FacetModeler::Body> createExtrusion(
+        const FacetModeler::DeviationParams& devDeviation,
+        const FacetModeler::Profile2D& base,
+        const OdGeVector3d& extrusionDirection,
+        double height,
+        const OdGeMatrix3d& rotation);
+
 	std::vector<std::shared_ptr<FacetModeler::Body>> mGeometries;
 	std::vector<GeometryTypeEnum> mGeometryTypes;
+    std::vector<std::vector<std::shared_ptr<FacetModeler::Body>>> mGeometryLods;   // levels 1.. of each geometry, empty for surfaces
+    std::vector<std::shared_ptr<const ExtrusionPrimitive>> mGeometryPrimitives;     // nullptr unless GeometryTypePrimitive
+    std::vector<std::size_t> mGeometryProductIndices;
+    std::vector<GeometryInstance> mInstances;
+    RepresentationMapCache mRepresentationMapCache;
+    ProfileCache mProfileCache;
+    DeviationPolicy mDeviationPolicy;
+    double mWeldTolerance = 1e-9;
+    bool mPrettyOutput = false;
+    bool mPrimitiveOutput = false;
+    std::shared_ptr<BrepStreamOutput> mStreamOutput;
+    std::size_t mStreamedGeometryCount = 0;         // output geometries already in the spill files
+    std::size_t mPendingLodCount = 0;               // levels of detail of the current product
+    std::vector<std::uint64_t> mOutputTriangles;    // per output geometry, for the instanced triangle count
+    TriangleBudget mTriangleBudget;
+    std::shared_ptr<FragmentCache> mFragmentCache;
+    std::shared_ptr<ProductHasher> mProductHasher;
+    std::uint64_t mProductHash = 0;                 // of the current product, 0 if it isn't cached
+    BrepOutputFormat mOutputFormat = BrepOutputFormat::Json;
+    std::size_t mCurrentProductIdx = 0;
 };
 
@@ -0,0 +1,169 @@
+#include "BrepJsonRenderer.h"
+
+#include <vector>
+
+void BrepJsonRenderer::render(BrepJsonWriter& writer, const Sections& sections)
+{
+    writer.beginObject();
+
+    // Levels of detail are sorted by geometry index, they are merged into the geometry entries
+    std::uint64_t lodCount = sections.geometryLods->count();
+    BrepBinary::GeometryLod nextLod = {};
+    if (lodCount != 0)
+    {
+        nextLod = sections.geometryLods->next<BrepBinary::GeometryLod>();
+    }
+
+    writer.beginArray("geometries");
+    std::uint64_t primitiveIdx = 0;
+    for (std::uint64_t geometryIdx = 0; geometryIdx < sections.geometries->count(); ++geometryIdx)
+    {
+        const BrepBinary::Geometry geometry = sections.geometries->next<BrepBinary::Geometry>();
+        writer.beginObject();
+        if (geometry.type == BrepBinary::kGeometryPrimitive)
+        {
+            writer.value("primitive", primitiveIdx++);
+        }
+        else if (geometry.type == BrepBinary::kGeometrySurface)
+        {
+            writer.beginArray("shells");
+            for (std::uint64_t shellIdx : { 0, 1, 2, 93 })
+            {
+                writer.value(shellIdx);
+            }
+            writer.endArray();
+        }
+        else
+        {
+            writer.value("solids", geometry.solidIdx);
+        }
+        if (lodCount != 0 && nextLod.geometryIdx == geometryIdx)
+        {
+            writer.value("lod", static_cast<std::uint64_t>(nextLod.level));
+            writer.value("lodOf", nextLod.baseGeometryIdx);
+            if (--lodCount != 0)
+            {
+                nextLod = sections.geometryLods->next<BrepBinary::GeometryLod>();
+            }
+        }
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.beginArray("vertices");
+    for (std::uint64_t vertexIdx = 0; vertexIdx < sections.vertices->count(); ++vertexIdx)
+    {
+        const BrepBinary::Vertex vertex = sections.vertices->next<BrepBinary::Vertex>();
+        writer.beginObject();
+        writer.beginArray("position");
+        writer.value(vertex.position[0]);
+        writer.value(vertex.position[1]);
+        writer.value(vertex.position[2]);
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.beginArray("edges");
+    for (std::uint64_t edgeIdx = 0; edgeIdx < sections.edgeVertices->count(); ++edgeIdx)
+    {
+        const BrepBinary::EdgeVertices edge = sections.edgeVertices->next<BrepBinary::EdgeVertices>();
+        writer.beginObject();
+        writer.beginArray("vertices");
+        writer.value(edge.vertices[0]);
+        writer.value(edge.vertices[1]);
+        writer.endArray();
+        writer.value("arcLength", sections.edgeArcLengths->next<double>());
+        writer.endObject();
+    }
+    writer.endArray();
+
+    // A face lists its loop edges, reversed when the loop runs against the edge direction
+    std::vector<BrepBinary::FaceEdge> faceEdges;
+    writer.beginArray("faces");
+    for (std::uint64_t faceIdx = 0; faceIdx < sections.faces->count(); ++faceIdx)
+    {
+        const BrepBinary::Face face = sections.faces->next<BrepBinary::Face>();
+        faceEdges.resize(static_cast<std::size_t>(face.faceEdgeCount));
+        for (auto& faceEdge : faceEdges)
+        {
+            faceEdge = sections.faceEdges->next<BrepBinary::FaceEdge>();
+        }
+
+        writer.beginObject();
+        writer.value("area", sections.faceAreas->next<double>());
+        writer.beginArray("edges");
+        for (const auto& faceEdge : faceEdges)
+        {
+            writer.value(faceEdge.edgeIdx);
+        }
+        writer.endArray();
+        writer.beginArray("reversed");
+        for (const auto& faceEdge : faceEdges)
+        {
+            writer.value(faceEdge.reversed != 0);
+        }
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+
+    // Analytic extrusions of the primitive geometries, in geometry order
+    writer.beginArray("primitives");
+    for (std::uint64_t recordIdx = 0; recordIdx < sections.primitives->count(); ++recordIdx)
+    {
+        const BrepBinary::Primitive primitive = sections.primitives->next<BrepBinary::Primitive>();
+        writer.beginObject();
+        if (primitive.type == BrepBinary::kPrimitiveCylinder)
+        {
+            writer.value("type", "cylinder");
+            writer.value("radius", primitive.radius);
+        }
+        else
+        {
+            writer.value("type", "extrusion");
+            writer.beginArray("profile");
+            for (std::uint64_t pointIdx = 0; pointIdx < primitive.profilePointCount; ++pointIdx)
+            {
+                const BrepBinary::ProfilePoint pt = sections.profilePoints->next<BrepBinary::ProfilePoint>();
+                writer.beginArray();
+                writer.value(pt.position[0]);
+                writer.value(pt.position[1]);
+                writer.endArray();
+            }
+            writer.endArray();
+        }
+        writer.beginArray("extrusion");
+        for (double component : primitive.extrusion)
+        {
+            writer.value(component);
+        }
+        writer.endArray();
+        writer.beginArray("placement");
+        for (double component : primitive.placement)
+        {
+            writer.value(component);
+        }
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.beginArray("instances");
+    for (std::uint64_t instanceIdx = 0; instanceIdx < sections.instances->count(); ++instanceIdx)
+    {
+        const BrepBinary::Instance instance = sections.instances->next<BrepBinary::Instance>();
+        writer.beginObject();
+        writer.value("geometry", instance.geometryIdx);
+        writer.beginArray("transform");
+        for (double component : instance.transform)
+        {
+            writer.value(component);
+        }
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.endObject();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "BrepBinaryFormat.h"
+#include "BrepJsonWriter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+
+// Renders the sections of the binary BREP format (see BrepBinaryFormat.h) as the BREP json document.
+// Every section is read front to back exactly once, either from memory or from the spill files of a streamed
+// conversion, so the json output never needs more than one face at a time in memory.
+class BrepJsonRenderer
+{
+public:
+    // Elements of one section, in file order
+    class Source
+    {
+    public:
+        explicit Source(std::uint64_t count) : mCount(count) {}
+        virtual ~Source() = default;
+
+        std::uint64_t count() const { return mCount; }
+
+        template<typename T>
+        T next()
+        {
+            T element;
+            read(&element, sizeof(T));
+            return element;
+        }
+
+    protected:
+        virtual void read(void* element, std::size_t size) = 0;
+
+    private:
+        std::uint64_t mCount;
+    };
+
+    class MemorySource : public Source
+    {
+    public:
+        template<typename T>
+        MemorySource(const T* elements, std::size_t count) : Source(count), mData(reinterpret_cast<const char*>(elements)) {}
+
+    protected:
+        void read(void* element, std::size_t size) override
+        {
+            std::memcpy(element, mData, size);
+            mData += size;
+        }
+
+    private:
+        const char* mData;
+    };
+
+    class StreamSource : public Source
+    {
+    public:
+        StreamSource(std::istream& stream, std::uint64_t count) : Source(count), mStream(stream) {}
+
+    protected:
+        void read(void* element, std::size_t size) override
+        {
+            mStream.read(static_cast<char*>(element), static_cast<std::streamsize>(size));
+        }
+
+    private:
+        std::istream& mStream;
+    };
+
+    struct Sections
+    {
+        Source* vertices;
+        Source* edgeVertices;
+        Source* edgeArcLengths;
+        Source* faces;
+        Source* faceEdges;
+        Source* faceAreas;
+        Source* geometries;
+        Source* geometryLods;
+        Source* primitives;
+        Source* profilePoints;
+        Source* instances;
+    };
+
+    // Writes the document object, geometries first and instances last
+    static void render(BrepJsonWriter& writer, const Sections& sections);
+};
@@ -0,0 +1,217 @@
+#include "BrepJsonWriter.h"
+
+#include <json/single_include/nlohmann/json.hpp>
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const int kPrettyIndent = 4;
+}
+
+BrepJsonWriter::BrepJsonWriter(std::ostream& stream, bool pretty, std::size_t bufferSize)
+    : mStream(stream)
+    , mPretty(pretty)
+{
+    mBuffer.reserve(bufferSize > 64 ? bufferSize : 64);
+}
+
+BrepJsonWriter::~BrepJsonWriter()
+{
+    flush();
+}
+
+void BrepJsonWriter::beginObject(const char* key)
+{
+    beginValue(key);
+    put('{');
+    mLevels.push_back({ false, true });
+}
+
+void BrepJsonWriter::endObject()
+{
+    const bool isEmpty = mLevels.back().isEmpty;
+    mLevels.pop_back();
+    if (!isEmpty)
+    {
+        newLine();
+    }
+    put('}');
+    if (mLevels.empty() && mPretty)
+    {
+        put('\n');
+    }
+}
+
+void BrepJsonWriter::beginArray(const char* key)
+{
+    beginValue(key);
+    put('[');
+    mLevels.push_back({ true, true });
+}
+
+void BrepJsonWriter::endArray()
+{
+    const bool isEmpty = mLevels.back().isEmpty;
+    mLevels.pop_back();
+    if (!isEmpty)
+    {
+        newLine();
+    }
+    put(']');
+}
+
+void BrepJsonWriter::value(double val)
+{
+    beginValue(nullptr);
+    writeDouble(val);
+}
+
+void BrepJsonWriter::value(std::uint64_t val)
+{
+    beginValue(nullptr);
+    writeUInt(val);
+}
+
+void BrepJsonWriter::value(bool val)
+{
+    beginValue(nullptr);
+    val ? put("true", 4) : put("false", 5);
+}
+
+void BrepJsonWriter::value(const char* key, double val)
+{
+    beginValue(key);
+    writeDouble(val);
+}
+
+void BrepJsonWriter::value(const char* key, std::uint64_t val)
+{
+    beginValue(key);
+    writeUInt(val);
+}
+
+void BrepJsonWriter::value(const char* key, bool val)
+{
+    beginValue(key);
+    val ? put("true", 4) : put("false", 5);
+}
+
+void BrepJsonWriter::value(const char* key, const char* val)
+{
+    beginValue(key);
+    writeString(val);
+}
+
+void BrepJsonWriter::flush()
+{
+    if (!mBuffer.empty())
+    {
+        mStream.write(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()));
+        mBytesFlushed += mBuffer.size();
+        mBuffer.clear();
+    }
+}
+
+void BrepJsonWriter::beginValue(const char* key)
+{
+    if (mLevels.empty())
+    {
+        return;
+    }
+
+    Level& level = mLevels.back();
+    if (!level.isEmpty)
+    {
+        put(',');
+    }
+    level.isEmpty = false;
+    newLine();
+
+    if (!level.isArray && key != nullptr)
+    {
+        put('"');
+        put(key, std::strlen(key));
+        put('"');
+        put(':');
+        if (mPretty)
+        {
+            put(' ');
+        }
+    }
+}
+
+void BrepJsonWriter::newLine()
+{
+    if (!mPretty)
+    {
+        return;
+    }
+
+    put('\n');
+    for (std::size_t i = 0; i < mLevels.size() * kPrettyIndent; ++i)
+    {
+        put(' ');
+    }
+}
+
+void BrepJsonWriter::writeDouble(double val)
+{
+    if (!std::isfinite(val))
+    {
+        put("null", 4);
+        return;
+    }
+
+    char buffer[64];
+    const char* end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), val);
+    put(buffer, static_cast<std::size_t>(end - buffer));
+}
+
+void BrepJsonWriter::writeUInt(std::uint64_t val)
+{
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* begin = end;
+    do
+    {
+        *--begin = static_cast<char>('0' + val % 10);
+        val /= 10;
+    } while (val != 0);
+    put(begin, static_cast<std::size_t>(end - begin));
+}
+
+void BrepJsonWriter::writeString(const char* val)
+{
+    put('"');
+    for (; *val != '\0'; ++val)
+    {
+        const unsigned char c = static_cast<unsigned char>(*val);
+        if (c == '"' || c == '\\')
+        {
+            put('\\');
+            put(*val);
+        }
+        else if (c < 0x20)
+        {
+            const char hex[] = "0123456789abcdef";
+            const char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            put(escaped, sizeof(escaped));
+        }
+        else
+        {
+            put(*val);
+        }
+    }
+    put('"');
+}
+
+void BrepJsonWriter::put(const char* str, std::size_t length)
+{
+    if (mBuffer.size() + length > mBuffer.capacity())
+    {
+        flush();
+    }
+    mBuffer.insert(mBuffer.end(), str, str + length);
+}
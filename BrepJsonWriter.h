@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Streaming JSON writer for the BREP output.
+// Values go through a fixed size buffer straight to the stream, nothing of the document is kept in memory.
+// Doubles are formatted with the shortest round trip representation (the same as nlohmann::json dumps).
+// Keys are written as given, they are expected to be plain identifiers without characters to escape.
+class BrepJsonWriter
+{
+public:
+    explicit BrepJsonWriter(std::ostream& stream, bool pretty = false, std::size_t bufferSize = 1 << 20);
+    ~BrepJsonWriter();
+
+    BrepJsonWriter(const BrepJsonWriter&) = delete;
+    BrepJsonWriter& operator=(const BrepJsonWriter&) = delete;
+
+    // key is ignored (must be nullptr) inside arrays and for the root
+    void beginObject(const char* key = nullptr);
+    void endObject();
+    void beginArray(const char* key = nullptr);
+    void endArray();
+
+    void value(double val);
+    void value(std::uint64_t val);
+    void value(bool val);
+    void value(const char* key, double val);
+    void value(const char* key, std::uint64_t val);
+    void value(const char* key, bool val);
+    void value(const char* key, const char* val);
+
+    void flush();
+
+    // Bytes handed to the stream plus the buffered ones
+    std::uint64_t bytesWritten() const { return mBytesFlushed + mBuffer.size(); }
+
+private:
+    struct Level
+    {
+        bool isArray;
+        bool isEmpty;
+    };
+
+    void beginValue(const char* key);
+    void newLine();
+    void writeDouble(double val);
+    void writeUInt(std::uint64_t val);
+    void writeString(const char* val);
+
+    void put(char c)
+    {
+        if (mBuffer.size() == mBuffer.capacity())
+        {
+            flush();
+        }
+        mBuffer.push_back(c);
+    }
+
+    void put(const char* str, std::size_t length);
+
+    std::ostream& mStream;
+    bool mPretty;
+    std::vector<char> mBuffer;
+    std::vector<Level> mLevels;
+    std::uint64_t mBytesFlushed = 0;
+};
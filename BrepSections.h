@@ -0,0 +1,23 @@
+#pragma once
+
+#include "BrepBinaryFormat.h"
+
+#include <cstdint>
+#include <vector>
+
+// Records of the binary format sections, edges are shared by the faces of each geometry
+struct BrepSections
+{
+    std::vector<BrepBinary::Geometry> geometries;
+    std::vector<std::uint64_t> solids;
+    std::vector<BrepBinary::EdgeVertices> edgeVertices;
+    std::vector<double> edgeArcLengths;
+    std::vector<BrepBinary::Face> faces;
+    std::vector<BrepBinary::FaceEdge> faceEdges;
+    std::vector<double> faceAreas;
+    std::vector<BrepBinary::Instance> instances;
+    std::vector<BrepBinary::GeometryLod> geometryLods;
+    std::vector<BrepBinary::Primitive> primitives;
+    std::vector<BrepBinary::ProfilePoint> profilePoints;
+    std::vector<std::uint64_t> geometryTriangles;     // fan triangulation of the faces, per geometry
+};
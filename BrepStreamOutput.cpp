@@ -0,0 +1,132 @@
+#include "BrepStreamOutput.h"
+#include "BrepBinaryWriter.h"
+#include "BrepJsonRenderer.h"
+
+#include <cstdio>
+
+namespace
+{
+    // Sections in the order of the non streamed binary output
+    const BrepBinary::SectionType kSectionOrder[] = {
+        BrepBinary::kSectionVertices,
+        BrepBinary::kSectionEdgeVertices,
+        BrepBinary::kSectionEdgeArcLengths,
+        BrepBinary::kSectionFaces,
+        BrepBinary::kSectionFaceEdges,
+        BrepBinary::kSectionFaceAreas,
+        BrepBinary::kSectionGeometries,
+        BrepBinary::kSectionSolids,
+        BrepBinary::kSectionInstances,
+        BrepBinary::kSectionGeometryLods,
+        BrepBinary::kSectionPrimitives,
+        BrepBinary::kSectionProfilePoints
+    };
+
+    std::uint32_t elementSize(BrepBinary::SectionType type)
+    {
+        switch (type)
+        {
+        case BrepBinary::kSectionVertices: return sizeof(BrepBinary::Vertex);
+        case BrepBinary::kSectionEdgeVertices: return sizeof(BrepBinary::EdgeVertices);
+        case BrepBinary::kSectionEdgeArcLengths: return sizeof(double);
+        case BrepBinary::kSectionFaceAreas: return sizeof(double);
+        case BrepBinary::kSectionGeometries: return sizeof(BrepBinary::Geometry);
+        case BrepBinary::kSectionSolids: return sizeof(std::uint64_t);
+        case BrepBinary::kSectionInstances: return sizeof(BrepBinary::Instance);
+        case BrepBinary::kSectionFaces: return sizeof(BrepBinary::Face);
+        case BrepBinary::kSectionFaceEdges: return sizeof(BrepBinary::FaceEdge);
+        case BrepBinary::kSectionGeometryLods: return sizeof(BrepBinary::GeometryLod);
+        case BrepBinary::kSectionPrimitives: return sizeof(BrepBinary::Primitive);
+        case BrepBinary::kSectionProfilePoints: return sizeof(BrepBinary::ProfilePoint);
+        }
+        return 0;
+    }
+}
+
+BrepStreamOutput::BrepStreamOutput(const std::string& outputFilename)
+    : mOutputFilename(outputFilename)
+{
+    mOpen = true;
+    for (BrepBinary::SectionType type : kSectionOrder)
+    {
+        Spill& spill = mSpills[type];
+        spill.filename = outputFilename + ".section" + std::to_string(static_cast<int>(type)) + ".part";
+        spill.stream.open(spill.filename.c_str(), std::fstream::in | std::fstream::out | std::fstream::trunc | std::fstream::binary);
+        mOpen = mOpen && spill.stream.is_open();
+    }
+}
+
+BrepStreamOutput::~BrepStreamOutput()
+{
+    removeSpills();
+}
+
+std::uint64_t BrepStreamOutput::finishBinary()
+{
+    rewind();
+    BrepBinaryWriter writer;
+    for (BrepBinary::SectionType type : kSectionOrder)
+    {
+        writer.addSection(type, elementSize(type), &mSpills[type].stream, static_cast<std::size_t>(mSpills[type].count));
+    }
+
+    std::ofstream outputStream(mOutputFilename.c_str(), std::ofstream::out | std::ofstream::binary);
+    const bool written = writer.write(outputStream);
+    const std::uint64_t bytesWritten = written ? static_cast<std::uint64_t>(outputStream.tellp()) : 0;
+    removeSpills();
+    return bytesWritten;
+}
+
+std::uint64_t BrepStreamOutput::finishJson(bool pretty)
+{
+    rewind();
+    auto source = [this](BrepBinary::SectionType type)
+    {
+        return BrepJsonRenderer::StreamSource(mSpills[type].stream, mSpills[type].count);
+    };
+    BrepJsonRenderer::StreamSource vertices = source(BrepBinary::kSectionVertices);
+    BrepJsonRenderer::StreamSource edgeVertices = source(BrepBinary::kSectionEdgeVertices);
+    BrepJsonRenderer::StreamSource edgeArcLengths = source(BrepBinary::kSectionEdgeArcLengths);
+    BrepJsonRenderer::StreamSource faces = source(BrepBinary::kSectionFaces);
+    BrepJsonRenderer::StreamSource faceEdges = source(BrepBinary::kSectionFaceEdges);
+    BrepJsonRenderer::StreamSource faceAreas = source(BrepBinary::kSectionFaceAreas);
+    BrepJsonRenderer::StreamSource geometries = source(BrepBinary::kSectionGeometries);
+    BrepJsonRenderer::StreamSource geometryLods = source(BrepBinary::kSectionGeometryLods);
+    BrepJsonRenderer::StreamSource primitives = source(BrepBinary::kSectionPrimitives);
+    BrepJsonRenderer::StreamSource profilePoints = source(BrepBinary::kSectionProfilePoints);
+    BrepJsonRenderer::StreamSource instances = source(BrepBinary::kSectionInstances);
+    const BrepJsonRenderer::Sections sections = {
+        &vertices, &edgeVertices, &edgeArcLengths, &faces, &faceEdges, &faceAreas,
+        &geometries, &geometryLods, &primitives, &profilePoints, &instances
+    };
+
+    std::ofstream outputStream(mOutputFilename.c_str(), std::ofstream::out);
+    BrepJsonWriter writer(outputStream, pretty);
+    BrepJsonRenderer::render(writer, sections);
+    writer.flush();
+    const std::uint64_t bytesWritten = outputStream ? writer.bytesWritten() : 0;
+    removeSpills();
+    return bytesWritten;
+}
+
+void BrepStreamOutput::rewind()
+{
+    for (BrepBinary::SectionType type : kSectionOrder)
+    {
+        mSpills[type].stream.flush();
+        mSpills[type].stream.seekg(0);
+    }
+}
+
+void BrepStreamOutput::removeSpills()
+{
+    for (BrepBinary::SectionType type : kSectionOrder)
+    {
+        Spill& spill = mSpills[type];
+        if (spill.stream.is_open())
+        {
+            spill.stream.close();
+            std::remove(spill.filename.c_str());
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "BrepBinaryFormat.h"
+#include "BrepJsonWriter.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Output of a streamed conversion. Every section of the binary format is appended to a spill file of its own as the
+// products are converted, the element counts are the running offsets of the next product. finish() then assembles
+// the output file from the spill files, as the binary format or rendered as json, and removes them.
+class BrepStreamOutput
+{
+public:
+    // The spill files are created next to the output file
+    explicit BrepStreamOutput(const std::string& outputFilename);
+    ~BrepStreamOutput();
+
+    BrepStreamOutput(const BrepStreamOutput&) = delete;
+    BrepStreamOutput& operator=(const BrepStreamOutput&) = delete;
+
+    bool isOpen() const { return mOpen; }
+
+    template<typename T>
+    void append(BrepBinary::SectionType type, const T* elements, std::size_t count)
+    {
+        Spill& spill = mSpills[type];
+        spill.stream.write(reinterpret_cast<const char*>(elements), static_cast<std::streamsize>(count * sizeof(T)));
+        spill.count += count;
+        mBytesSpilled += count * sizeof(T);
+    }
+
+    // Elements appended to the section so far
+    std::uint64_t count(BrepBinary::SectionType type) const { return mSpills[type].count; }
+
+    std::uint64_t bytesSpilled() const { return mBytesSpilled; }
+
+    // Writes the output file, returns the number of bytes written or 0 if it failed
+    std::uint64_t finishBinary();
+    std::uint64_t finishJson(bool pretty);
+
+private:
+    static const int kSectionSlots = BrepBinary::kSectionProfilePoints + 1;
+
+    struct Spill
+    {
+        std::string filename;
+        std::fstream stream;
+        std::uint64_t count = 0;
+    };
+
+    void rewind();
+    void removeSpills();
+
+    std::string mOutputFilename;
+    Spill mSpills[kSectionSlots];
+    std::uint64_t mBytesSpilled = 0;
+    bool mOpen = false;
+};
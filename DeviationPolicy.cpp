@@ -0,0 +1,180 @@
+#include "DeviationPolicy.h"
+#include "AttributeHelper.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Deviation as a fraction of the profile diameter at quality 1
+    const double kRelativeDeviation = 0.002;
+
+    // Floor of the deviation of degenerate profiles, in model units
+    const double kMinDeviation = 1e-9;
+
+    // Bounds of the segments per circle at quality 1
+    const OdUInt32 kMinPerCircle = 6;
+    const OdUInt32 kMaxPerCircle = 128;
+    const OdUInt32 kMinPerCircleCoarse = 4;
+
+    // Deviation of a vectorized product as a fraction of its cross-section size at quality 1
+    const double kRelativeDrawableDeviation = 0.002;
+
+    // Elements a part is looked up in for a class tolerance, a curtain wall part is one level down
+    const int kMaxAggregateDepth = 4;
+
+    // Deviation of a vectorized product without extents at quality 1, in model units
+    const double kDefaultDrawableDeviation = 0.8;
+}
+
+DeviationPolicy::DeviationPolicy()
+{
+    setClassTolerance(OdIfc::kIfcFlowFitting, 4.0);
+    setClassTolerance(OdIfc::kIfcFastener, 4.0);
+    setClassTolerance(OdIfc::kIfcFurnishingElement, 2.0);
+    setClassTolerance(OdIfc::kIfcCurtainWall, 0.25);
+}
+
+FacetModeler::DeviationParams DeviationPolicy::sweptSolid(double radius, unsigned int lod) const
+{
+    const double size = 2.0 * std::fabs(radius);
+    const double lodScale = std::pow(4.0, static_cast<double>(lod));
+
+    FacetModeler::DeviationParams params;
+    params.Deviation = std::max(kRelativeDeviation * size * lodScale / (mQuality * mQuality), kMinDeviation);
+    if (radius > 0.0)
+    {
+        params.Deviation = std::min(params.Deviation, std::fabs(radius));
+    }
+    params.MinPerCircle = std::max(kMinPerCircleCoarse, kMinPerCircle >> std::min(lod, 31u));
+    params.MaxPerCircle = std::max(params.MinPerCircle, static_cast<OdUInt32>(kMaxPerCircle * std::min(mQuality, 8.0) / std::sqrt(lodScale)));
+    return params;
+}
+
+void DeviationPolicy::setClassTolerance(OdIfc::OdIfcEntityType type, double tolerance)
+{
+    tolerance = tolerance > 0.0 ? tolerance : 1.0;
+    for (auto& classTolerance : mClassTolerances)
+    {
+        if (classTolerance.first == type)
+        {
+            classTolerance.second = tolerance;
+            return;
+        }
+    }
+    mClassTolerances.emplace_back(type, tolerance);
+}
+
+double DeviationPolicy::ownClassTolerance(OdIfc::OdIfcInstance* inst) const
+{
+    if (inst != nullptr)
+    {
+        for (const auto& classTolerance : mClassTolerances)
+        {
+            if (inst->isKindOf(classTolerance.first))
+            {
+                return classTolerance.second;
+            }
+        }
+    }
+    return 0.0;
+}
+
+double DeviationPolicy::classTolerance(OdIfc::OdIfcInstance* product) const
+{
+    const double tolerance = ownClassTolerance(product);
+    if (tolerance > 0.0)
+    {
+        return tolerance;
+    }
+    if (mAggregates && product != nullptr)
+    {
+        auto it = mAggregates->find((OdUInt64)product->id().getHandle());
+        if (it != mAggregates->end())
+        {
+            return it->second;
+        }
+    }
+    return 1.0;
+}
+
+void DeviationPolicy::collectAggregates(OdIfcModel* pModel)
+{
+    BREP_PROFILE_SCOPE("collectAggregates");
+    mAggregates.reset();
+    if (mClassTolerances.empty())
+    {
+        return;
+    }
+
+    OdDAI::Set<OdDAIObjectId>* extent = pModel->getEntityExtent("ifcrelaggregates");
+    if (extent == nullptr || extent->isNil())
+    {
+        return;
+    }
+
+    std::unordered_map<OdUInt64, OdDAIObjectId> elements;   // part handle -> element
+    for (OdDAI::ConstIteratorPtr it = extent->createConstIterator(); it->next();)
+    {
+        OdDAIObjectId relId;
+        it->getCurrentMember() >> relId;
+        OdIfc::OdIfcInstancePtr pRel = relId.openObject();
+        if (pRel.isNull())
+        {
+            continue;
+        }
+
+        OdDAIObjectId elementId;
+        if (!(AttributeHelper::getAttr(pRel, "relatingobject") >> elementId) || elementId.isNull())
+        {
+            continue;
+        }
+        const AttributeHelper::InstanceRange parts = AttributeHelper::getAttributeAsInstanceRange(pRel, "relatedobjects");
+        for (std::size_t partIdx = 0; partIdx < parts.size(); ++partIdx)
+        {
+            elements.emplace((OdUInt64)parts.id(partIdx).getHandle(), elementId);
+        }
+    }
+
+    // The tolerance of every part is resolved here, only the parts under an element with a class tolerance are kept
+    // and a product then costs one lookup instead of opening its elements
+    auto tolerances = std::make_shared<std::unordered_map<OdUInt64, double>>();
+    std::unordered_map<OdUInt64, double> elementTolerances;   // element handle -> own class tolerance, 0 if none
+    for (const auto& part : elements)
+    {
+        OdDAIObjectId elementId = part.second;
+        for (int depth = 0; depth < kMaxAggregateDepth; ++depth)
+        {
+            const OdUInt64 elementHandle = (OdUInt64)elementId.getHandle();
+            auto cached = elementTolerances.find(elementHandle);
+            if (cached == elementTolerances.end())
+            {
+                OdIfc::OdIfcInstancePtr pElement = elementId.openObject();
+                cached = elementTolerances.emplace(elementHandle, ownClassTolerance(pElement.get())).first;
+            }
+            if (cached->second > 0.0)
+            {
+                tolerances->emplace(part.first, cached->second);
+                break;
+            }
+
+            auto parent = elements.find(elementHandle);
+            if (parent == elements.end())
+            {
+                break;
+            }
+            elementId = parent->second;
+        }
+    }
+    if (!tolerances->empty())
+    {
+        mAggregates = tolerances;
+    }
+}
+
+double DeviationPolicy::drawable(double extentSize, double classTolerance) const
+{
+    const double deviation = extentSize > 0.0 ? kRelativeDrawableDeviation * extentSize : kDefaultDrawableDeviation;
+    return deviation * classTolerance * mBudgetScale / (mQuality * mQuality);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include "FMProfile3D.h"
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Chord deviation of the tessellated swept solids, scaled to the size of each profile.
+// A fixed deviation over-tessellates a 5 mm rebar and under-tessellates a 2 m duct; here the deviation is a fraction
+// of the profile diameter, so the segments per circle no longer depend on the size of the part. The extrusion depth
+// doesn't coarsen the profile, a long pipe keeps the segments of a short one.
+// Products drawn by the SDK vectorizer get a deviation from the cross-section of their extents (the middle one of
+// the three extent dimensions, a long pipe run or a flat plate is sized by its width), scaled by the tolerance of
+// their IFC class or of the element they are a part of.
+class DeviationPolicy
+{
+public:
+    DeviationPolicy();
+
+    // Scales the segment count of every solid, 2 is about twice as fine, 0.5 about twice as coarse.
+    // The segments per circle go with the inverse square root of the deviation, it is divided by quality squared
+    void setQuality(double quality) { mQuality = quality > 0.0 ? quality : 1.0; }
+    double quality() const { return mQuality; }
+
+    // Number of levels of detail converted per solid, 1 converts level 0 only
+    void setLodCount(unsigned int lodCount) { mLodCount = lodCount > 0 ? lodCount : 1; }
+    unsigned int lodCount() const { return mLodCount; }
+
+    // Level 0 is the finest, every further level allows four times the deviation (half the segments per circle)
+    FacetModeler::DeviationParams sweptSolid(double radius, unsigned int lod = 0) const;
+
+    // Tolerance of the products of an IFC class and its subtypes, 2 allows twice the deviation. The classes are
+    // matched in the order they were set, set subtypes before their supertypes. Defaults are coarse for fittings
+    // and fasteners and fine for curtain walls.
+    // A product whose own class has no tolerance takes the one of the element it is aggregated into, the plates
+    // and members of a curtain wall are drawn as products of their own
+    void setClassTolerance(OdIfc::OdIfcEntityType type, double tolerance);
+    double classTolerance(OdIfc::OdIfcInstance* product) const;
+
+    // Reads the IfcRelAggregates extent of the model and keeps the parts of the elements with a class tolerance,
+    // those parts then take the tolerance of their element. Nothing is kept when no element has one
+    void collectAggregates(OdIfcModel* pModel);
+
+    // Chord deviation of a vectorized product whose extents have this cross-section size, 0 if it has no extents
+    double drawable(double extentSize, double classTolerance) const;
+
+    // Triangles the vectorized products should have in total, 0 keeps the deviations as they are.
+    // The budget scale multiplies every drawable deviation, it is adjusted between vectorization passes
+    void setTriangleBudget(std::size_t triangleBudget) { mTriangleBudget = triangleBudget; }
+    std::size_t triangleBudget() const { return mTriangleBudget; }
+    void setBudgetScale(double budgetScale) { mBudgetScale = budgetScale > 0.0 ? budgetScale : 1.0; }
+    double budgetScale() const { return mBudgetScale; }
+
+private:
+    // Tolerance of the first class the instance is a kind of, 0 if none
+    double ownClassTolerance(OdIfc::OdIfcInstance* inst) const;
+
+    double mQuality = 1.0;
+    unsigned int mLodCount = 1;
+    std::vector<std::pair<OdIfc::OdIfcEntityType, double>> mClassTolerances;
+    std::shared_ptr<const std::unordered_map<OdUInt64, double>> mAggregates;   // part handle -> tolerance of its element
+    std::size_t mTriangleBudget = 0;
+    double mBudgetScale = 1.0;
+};
@@ -32,7 +32,11 @@
 
 #include "daiApplicationInstance.h"
 
+#include <algorithm>
+
 ExGsSimpleDevice::ExGsSimpleDevice()
+  : m_pCapture(0)
+  , m_pDeviationPolicy(0)
 {
   /**********************************************************************/
   /* Set a palette with a white background.                             */
@@ -49,13 +53,22 @@ ExGsSimpleDevice::ExGsSimpleDevice()
   onSize(OdGsDCRect(0,100,0,100));
 }
 
-OdGsDevicePtr ExGsSimpleDevice::createObject(DeviceType type)
+OdGsDevicePtr ExGsSimpleDevice::createObject(DeviceType type, TriangleCapture* pCapture)
 {
   OdGsDevicePtr pRes = OdRxObjectImpl<ExGsSimpleDevice, OdGsDevice>::createObject();
   ExGsSimpleDevice* pMyDev = static_cast<ExGsSimpleDevice*>(pRes.get());
 
   pMyDev->m_type = type;
 
+  /**********************************************************************/
+  /* Captured triangles go straight to the flat buffers                 */
+  /**********************************************************************/
+  pMyDev->m_pCapture = pCapture;
+  if (pCapture)
+  {
+    pMyDev->m_pCaptureGeometry.reset(new TriangleCaptureGeometry(*pCapture));
+  }
+
   /**********************************************************************/
   /* Create the output geometry dumper                                  */
   /**********************************************************************/  
@@ -97,7 +110,7 @@ OdGsViewPtr ExGsSimpleDevice::createView(const OdGsClientViewInfo* pInfo,
   /* Directs the output geometry for the view to the                    */
   /* destination geometry object                                        */
   /**********************************************************************/
-  pMyView->output().setDestGeometry(*m_pDestGeometry);
+  pMyView->output().setDestGeometry(*destGeometry());
 
   return (OdGsView*)pMyView;
 } 
@@ -107,9 +120,27 @@ OdGsViewPtr ExGsSimpleDevice::createView(const OdGsClientViewInfo* pInfo,
 /************************************************************************/  
 OdGiConveyorGeometry* ExGsSimpleDevice::destGeometry()
 {
+  if (m_pCaptureGeometry)
+  {
+    return m_pCaptureGeometry.get();
+  }
   return m_pDestGeometry;
 }
 
+void ExGsSimpleDevice::setProductSelection(const std::vector<OdUInt64>& handles)
+{
+  m_selectedProducts.clear();
+  m_selectedProducts.insert(handles.begin(), handles.end());
+}
+
+void ExGsSimpleDevice::setOutputToWorld(const OdGeMatrix3d& outputToWorld)
+{
+  if (m_pCaptureGeometry)
+  {
+    m_pCaptureGeometry->setOutputToWorld(outputToWorld);
+  }
+}
+
 /************************************************************************/
 /* Returns the geometry dumper associated with this object.             */
 /************************************************************************/  
@@ -131,6 +162,9 @@ void ExSimpleView::ownerDrawDc(const OdGePoint3d& origin,
   OdGePoint3d originXformed(eyeToOutput * origin);
   OdGeVector3d uXformed(eyeToOutput * u), vXformed(eyeToOutput * v);
 
+  if (device()->capture())
+    return;
+
   OdGiDumper* pDumper = device()->dumper();
 
   pDumper->output(OD_T("ownerDrawDc"));
@@ -236,6 +270,31 @@ bool ExSimpleView::regenAbort() const
 void ExSimpleView::draw(const OdGiDrawable* pDrawable)
 {
   OdDAIObjectId id = pDrawable->id();
+  const OdUInt64 handle = (OdUInt64)id.getHandle();
+
+  /**********************************************************************/
+  /* Only the top level drawables are products, the selection doesn't   */
+  /* apply to the items they draw.                                      */
+  /**********************************************************************/
+  if (m_nDrawDepth == 0 && !device()->isProductSelected(handle))
+    return;
+
+  if (m_nDrawDepth == 0)
+    m_dDeviation = productDeviation(pDrawable, id);
+
+  TriangleCapture* pCapture = device()->capture();
+  if (pCapture)
+  {
+    const bool bProduct = (m_nDrawDepth == 0);
+    if (bProduct)
+      pCapture->beginProduct(handle);
+    ++m_nDrawDepth;
+    OdGsBaseVectorizer::draw(pDrawable);
+    --m_nDrawDepth;
+    if (bProduct)
+      pCapture->endProduct();
+    return;
+  }
 
   OdAnsiString typeName;
 
@@ -243,21 +302,10 @@ void ExSimpleView::draw(const OdGiDrawable* pDrawable)
   if (!daiInstance.isNull())
   {
     typeName = daiInstance->getInstanceType()->originalName();
-    //if (daiInstance->isKindOf("ifcproduct"))
-    //{
-    //  OdDAIObjectId ifcProductId = id;
-    //  if (ifcProductId.getHandle() == (OdUInt64)NNN)
-    //  {
-    //    bool breakPoint = true;
-    //  }
-    //}
   }
 
-  // BC!!
-  if ((OdUInt64)id.getHandle() != 429 && (OdUInt64)id.getHandle() != 3470 && (OdUInt64)id.getHandle() != 3471) return;
-
   OdString sClassName = toString(pDrawable->isA());
-  OdString sInfo = OdString().format(OD_T("%s (#%lu=%hs)"), sClassName.c_str(), (OdUInt64)id.getHandle(), typeName.c_str());
+  OdString sInfo = OdString().format(OD_T("%s (#%lu=%hs)"), sClassName.c_str(), handle, typeName.c_str());
 
   device()->dumper()->output(OD_T(""));
   device()->dumper()->output(OD_T("Start Drawing ") + sInfo);
@@ -266,12 +314,44 @@ void ExSimpleView::draw(const OdGiDrawable* pDrawable)
   /**********************************************************************/
   /* The parent class version of this function must be called.          */
   /**********************************************************************/
+  ++m_nDrawDepth;
   OdGsBaseVectorizer::draw(pDrawable);
+  --m_nDrawDepth;
 
   device()->dumper()->popIndent();
   device()->dumper()->output(OD_T("End Drawing ") + sClassName);
 }
 
+const double ExSimpleView::kDefaultDeviation = 0.8;
+
+double ExSimpleView::productDeviation(const OdGiDrawable* pDrawable, const OdDAIObjectId& id)
+{
+  const DeviationPolicy* pPolicy = device()->deviationPolicy();
+  if (!pPolicy)
+    return kDefaultDeviation;
+
+  double extentSize = 0.0;
+  OdGeExtents3d extents;
+  if (pDrawable->getGeomExtents(extents) == eOk && extents.isValidExtents())
+  {
+    /********************************************************************/
+    /* The middle extent dimension sizes the cross-section: the width   */
+    /* of a long pipe run or column, the width of a flat plate.         */
+    /********************************************************************/
+    const OdGeVector3d size = extents.maxPoint() - extents.minPoint();
+    double dims[3] = { size.x, size.y, size.z };
+    std::sort(dims, dims + 3);
+    extentSize = dims[1];
+  }
+
+  double classTolerance = 1.0;
+  OdIfc::OdIfcInstancePtr pInst = id.openObject();
+  if (!pInst.isNull())
+    classTolerance = pPolicy->classTolerance(pInst);
+
+  return pPolicy->drawable(extentSize, classTolerance);
+}
+
 /************************************************************************/
 /* Flushes any queued graphics to the display device.                   */
 /************************************************************************/
@@ -283,6 +363,11 @@ void ExSimpleView::updateViewport()
   /**********************************************************************/
   (static_cast<OdGiGeometrySimplifier*>(device()->destGeometry()))->setDrawContext(drawContext());
 
+  /**********************************************************************/
+  /* Captured triangles are taken back from the output to world space   */
+  /**********************************************************************/
+  device()->setOutputToWorld((eyeToOutputTransform() * getWorldToEyeTransform()).inverse());
+
 #define _NO_CLIPPING
 #ifdef _NO_CLIPPING
 
@@ -381,7 +466,7 @@ void ExSimpleView::beginViewVectorization()
 
 void ExGsSimpleDevice::setupSimplifier(const OdGiDeviation* pDeviation)
 {
-  m_pDestGeometry->setDeviation(pDeviation);
+  static_cast<OdGiGeometrySimplifier*>(destGeometry())->setDeviation(pDeviation);
 }
 
 
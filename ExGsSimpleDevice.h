@@ -36,6 +36,13 @@
 #include "daiObjectId.h"
 #include "ExPrintConsole.h"
 
+#include "TriangleCapture.h"
+#include "DeviationPolicy.h"
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
 class ExSimpleView;
 
 /************************************************************************/
@@ -47,6 +54,10 @@ class ExGsSimpleDevice :
 {
   OdGiConveyorGeometryDumperPtr m_pDestGeometry;
   OdGiDumperPtr                 m_pDumper;
+  std::unique_ptr<TriangleCaptureGeometry> m_pCaptureGeometry;
+  TriangleCapture*              m_pCapture;
+  std::unordered_set<OdUInt64>  m_selectedProducts;
+  const DeviationPolicy*        m_pDeviationPolicy;
 
 public:
   enum DeviceType
@@ -58,9 +69,42 @@ public:
   ExGsSimpleDevice();
 
   /**********************************************************************/
-  /* Set the target data stream and the type.                           */
+  /* Set the target data stream and the type. With a capture the        */
+  /* triangles of the products are appended to it in world space        */
+  /* instead of being dumped as text.                                   */
   /**********************************************************************/
-  static OdGsDevicePtr createObject(DeviceType type);
+  static OdGsDevicePtr createObject(DeviceType type, TriangleCapture* pCapture = 0);
+
+  /**********************************************************************/
+  /* Restricts the vectorization to the products with these handles,    */
+  /* an empty selection draws every product.                            */
+  /**********************************************************************/
+  void setProductSelection(const std::vector<OdUInt64>& handles);
+
+  bool isProductSelected(OdUInt64 handle) const
+  {
+    return m_selectedProducts.empty() || m_selectedProducts.count(handle) != 0;
+  }
+
+  /**********************************************************************/
+  /* Sets the policy that gives every product a deviation from its      */
+  /* extents and its IFC class. The policy must outlive the device,     */
+  /* without one the views use a constant deviation.                    */
+  /**********************************************************************/
+  void setDeviationPolicy(const DeviationPolicy* pDeviationPolicy) { m_pDeviationPolicy = pDeviationPolicy; }
+
+  const DeviationPolicy* deviationPolicy() const { return m_pDeviationPolicy; }
+
+  /**********************************************************************/
+  /* Returns the triangle capture, or 0 if the device dumps geometry.   */
+  /**********************************************************************/
+  TriangleCapture* capture() { return m_pCapture; }
+
+  /**********************************************************************/
+  /* Called by each associated view with the inverse of its output      */
+  /* transform, so the captured triangles are in world space.           */
+  /**********************************************************************/
+  void setOutputToWorld(const OdGeMatrix3d& outputToWorld);
 
   /**********************************************************************/
   /* Called by the ODA Platform vectorization framework to update	*/
@@ -141,6 +185,8 @@ typedef OdSmartPtr<ExGsSimpleDevice> ExGsSimpleDevicePtr;
 class ExSimpleView : public OdGsBaseVectorizeViewDef
 {
   OdGiClipBoundary        m_eyeClip;
+  int                     m_nDrawDepth;
+  double                  m_dDeviation;
 protected:
 
   /**********************************************************************/
@@ -154,6 +200,8 @@ protected:
   }
 
   ExSimpleView()
+    : m_nDrawDepth(0)
+    , m_dDeviation(kDefaultDeviation)
   {
     m_eyeClip.m_bDrawBoundary = false;
   }
@@ -173,7 +221,14 @@ protected:
   /**********************************************************************/
   void setEntityTraits();
 
+  /**********************************************************************/
+  /* Deviation of the product about to be drawn, from the deviation     */
+  /* policy of the device.                                              */
+  /**********************************************************************/
+  double productDeviation(const OdGiDrawable* pDrawable, const OdDAIObjectId& id);
+
 public:
+  static const double kDefaultDeviation;
 
   /**********************************************************************/
   /* Called by the ODA Platform vectorization framework to vectorize */
@@ -194,12 +249,11 @@ public:
 
   /**********************************************************************/
   /* Returns the recommended maximum deviation of the current           */
-  /* vectorization.                                                     */
+  /* vectorization, the one of the product being drawn.                 */
   /**********************************************************************/
   double deviation(const OdGiDeviationType, const OdGePoint3d&) const
   {
-    // NOTE: use some reasonable value
-    return 0.8; //0.000001; 
+    return m_dDeviation;
   }
 
   /**********************************************************************/
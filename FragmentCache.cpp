@@ -0,0 +1,118 @@
+#include "FragmentCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace
+{
+    const char kFragmentMagic[8] = { 'B', 'R', 'E', 'P', 'F', 'R', 'A', 'G' };
+    // Bumped whenever the conversion of a product changes, the fragments of older versions are converted again
+    const std::uint32_t kFragmentVersion = 3;
+    const int kArrayCount = 13;
+
+    // Element counts of the arrays, in file order
+    struct FragmentHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+        std::uint64_t counts[kArrayCount];
+    };
+
+    // Reads or writes every array of a fragment in file order
+    template<typename Fragment, typename Visit>
+    void visitArrays(Fragment& fragment, Visit&& visit)
+    {
+        auto& sections = fragment.sections;
+        visit(fragment.vertices);
+        visit(sections.geometries);
+        visit(sections.solids);
+        visit(sections.edgeVertices);
+        visit(sections.edgeArcLengths);
+        visit(sections.faces);
+        visit(sections.faceEdges);
+        visit(sections.faceAreas);
+        visit(sections.instances);
+        visit(sections.geometryLods);
+        visit(sections.primitives);
+        visit(sections.profilePoints);
+        visit(sections.geometryTriangles);
+    }
+}
+
+FragmentCache::FragmentCache(const std::string& directory)
+    : mDirectory(directory)
+{
+    if (!mDirectory.empty() && mDirectory.back() != '/' && mDirectory.back() != '\\')
+    {
+        mDirectory += '/';
+    }
+}
+
+std::string FragmentCache::filename(std::uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.brepfrag", static_cast<unsigned long long>(key));
+    return mDirectory + name;
+}
+
+bool FragmentCache::load(std::uint64_t key, BrepFragment& fragment) const
+{
+    std::ifstream fragmentStream(filename(key).c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!fragmentStream)
+    {
+        return false;
+    }
+
+    FragmentHeader header;
+    fragmentStream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!fragmentStream || std::char_traits<char>::compare(header.magic, kFragmentMagic, sizeof(kFragmentMagic)) != 0 || header.version != kFragmentVersion)
+    {
+        return false;
+    }
+
+    int arrayIdx = 0;
+    visitArrays(fragment, [&](auto& elements)
+        {
+            elements.resize(static_cast<std::size_t>(header.counts[arrayIdx++]));
+            fragmentStream.read(reinterpret_cast<char*>(elements.data()), static_cast<std::streamsize>(elements.size() * sizeof(elements[0])));
+        });
+    return static_cast<bool>(fragmentStream);
+}
+
+bool FragmentCache::store(std::uint64_t key, const BrepFragment& fragment) const
+{
+    FragmentHeader header = {};
+    std::char_traits<char>::copy(header.magic, kFragmentMagic, sizeof(kFragmentMagic));
+    header.version = kFragmentVersion;
+    int arrayIdx = 0;
+    visitArrays(fragment, [&](auto& elements) { header.counts[arrayIdx++] = elements.size(); });
+
+    // Another conversion may store the same fragment at the same time, the temporary file is private to this thread
+    const std::string fragmentFilename = filename(key);
+    const std::string temporaryFilename = fragmentFilename + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream fragmentStream(temporaryFilename.c_str(), std::ofstream::out | std::ofstream::binary);
+        fragmentStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        visitArrays(fragment, [&](auto& elements)
+            {
+                fragmentStream.write(reinterpret_cast<const char*>(elements.data()), static_cast<std::streamsize>(elements.size() * sizeof(elements[0])));
+            });
+        if (!fragmentStream)
+        {
+            fragmentStream.close();
+            std::remove(temporaryFilename.c_str());
+            return false;
+        }
+    }
+
+    // rename() fails on Windows if the fragment exists already, it is then the same fragment
+    if (std::rename(temporaryFilename.c_str(), fragmentFilename.c_str()) != 0)
+    {
+        std::remove(temporaryFilename.c_str());
+    }
+    return true;
+}
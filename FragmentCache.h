@@ -0,0 +1,36 @@
+#pragma once
+
+#include "BrepBinaryFormat.h"
+#include "BrepSections.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Converted product, as the section records of its geometries. Vertex, edge, face, solid and geometry indices are
+// local to the product; instances reference the geometries of the product only, also by local index.
+struct BrepFragment
+{
+    std::vector<BrepBinary::Vertex> vertices;
+    BrepSections sections;
+};
+
+// On disk cache of product fragments keyed by the content hash of the product (see ProductHasher).
+// Every fragment is a file of its own in the cache directory, written to a temporary file first and renamed,
+// so concurrent conversions can share a directory.
+class FragmentCache
+{
+public:
+    // The directory must exist
+    explicit FragmentCache(const std::string& directory);
+
+    // Returns false if there is no fragment for key or it can't be read
+    bool load(std::uint64_t key, BrepFragment& fragment) const;
+
+    bool store(std::uint64_t key, const BrepFragment& fragment) const;
+
+private:
+    std::string filename(std::uint64_t key) const;
+
+    std::string mDirectory;
+};
@@ -0,0 +1,173 @@
+#include "GlobalIdIndex.h"
+#include "AttributeHelper.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+    const char* const kIndexSignature = "ifc2brep-globalid-index";
+    const int kIndexVersion = 2;
+
+    // Bytes hashed at the start and at the end of the source file
+    const std::streamoff kFingerprintBlockSize = 64 * 1024;
+
+    // FNV-1a
+    OdUInt64 hashBytes(OdUInt64 hash, const char* data, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string trim(const std::string& str)
+    {
+        const char* whitespaces = " \t\r\n";
+        std::size_t first = str.find_first_not_of(whitespaces);
+        if (first == std::string::npos)
+        {
+            return std::string();
+        }
+        std::size_t last = str.find_last_not_of(whitespaces);
+        return str.substr(first, last - first + 1);
+    }
+}
+
+void GlobalIdIndex::build(OdIfcModel* pModel)
+{
+    BREP_PROFILE_SCOPE("buildGlobalIdIndex");
+    mHandles.clear();
+
+    OdDAI::InstanceIteratorPtr it = pModel->newIterator();
+    for (; !it->done(); it->step())
+    {
+        OdDAIObjectId id = it->id();
+        Profiler::count(ProfileCounter::InstancesVisited);
+        OdIfc::OdIfcInstancePtr pInst = id.openObject();
+        if (pInst.isNull())
+        {
+            continue;
+        }
+
+        // Only IfcRoot subtypes own a globalid, the value stays empty for the rest
+        const char* globalid = nullptr;
+        OdRxValue val = AttributeHelper::getAttr(pInst, "globalid");
+        if (val.isEmpty() || !(val >> globalid) || globalid == nullptr)
+        {
+            continue;
+        }
+
+        mHandles.emplace(globalid, (OdUInt64)id.getHandle());
+    }
+}
+
+bool GlobalIdIndex::load(const OdString& strIndexFilename, const OdString& strSourceFilename)
+{
+    std::ifstream indexFileStream(strIndexFilename.c_str(), std::ifstream::in);
+    if (!indexFileStream)
+    {
+        return false;
+    }
+
+    std::string signature;
+    int version = 0;
+    OdUInt64 sourceFingerprint = 0;
+    std::size_t count = 0;
+    indexFileStream >> signature >> version >> sourceFingerprint >> count;
+    if (!indexFileStream || signature != kIndexSignature || version != kIndexVersion || sourceFingerprint != fileFingerprint(strSourceFilename))
+    {
+        return false;
+    }
+
+    std::unordered_map<std::string, OdUInt64> handles;
+    handles.reserve(count);
+    std::string globalId;
+    OdUInt64 handle = 0;
+    while (indexFileStream >> globalId >> handle)
+    {
+        handles.emplace(globalId, handle);
+    }
+    if (handles.size() != count)
+    {
+        return false;
+    }
+
+    mHandles.swap(handles);
+    return true;
+}
+
+bool GlobalIdIndex::save(const OdString& strIndexFilename, const OdString& strSourceFilename) const
+{
+    std::ofstream indexFileStream(strIndexFilename.c_str(), std::ofstream::out);
+    if (!indexFileStream)
+    {
+        return false;
+    }
+
+    indexFileStream << kIndexSignature << ' ' << kIndexVersion << ' ' << fileFingerprint(strSourceFilename) << ' ' << mHandles.size() << '\n';
+    for (const auto& entry : mHandles)
+    {
+        indexFileStream << entry.first << ' ' << entry.second << '\n';
+    }
+
+    return static_cast<bool>(indexFileStream);
+}
+
+OdDAIObjectId GlobalIdIndex::find(OdIfcModel* pModel, const std::string& globalId) const
+{
+    auto it = mHandles.find(globalId);
+    if (it == mHandles.end())
+    {
+        return OdDAIObjectId();
+    }
+
+    return pModel->getEntityInstance(OdDbHandle(it->second));
+}
+
+std::vector<std::string> GlobalIdIndex::readGlobalIds(const OdString& strGuidFilename)
+{
+    std::vector<std::string> ret;
+    std::ifstream guidFileStream(strGuidFilename.c_str(), std::ifstream::in);
+    std::string line;
+    while (std::getline(guidFileStream, line))
+    {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        ret.push_back(line);
+    }
+
+    return ret;
+}
+
+OdUInt64 GlobalIdIndex::fileFingerprint(const OdString& strFilename)
+{
+    std::ifstream fileStream(strFilename.c_str(), std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+    if (!fileStream)
+    {
+        return 0;
+    }
+
+    const std::streamoff size = static_cast<std::streamoff>(fileStream.tellg());
+    OdUInt64 hash = hashBytes(14695981039346656037ull, reinterpret_cast<const char*>(&size), sizeof(size));
+
+    std::vector<char> block(static_cast<std::size_t>(kFingerprintBlockSize));
+    const std::streamoff headSize = std::min(size, kFingerprintBlockSize);
+    fileStream.seekg(0);
+    fileStream.read(block.data(), headSize);
+    hash = hashBytes(hash, block.data(), static_cast<std::size_t>(fileStream.gcount()));
+
+    const std::streamoff tailStart = std::max(headSize, size - kFingerprintBlockSize);
+    fileStream.clear();
+    fileStream.seekg(tailStart);
+    fileStream.read(block.data(), size - tailStart);
+    hash = hashBytes(hash, block.data(), static_cast<std::size_t>(fileStream.gcount()));
+
+    // 0 means no fingerprint
+    return hash != 0 ? hash : 1;
+}
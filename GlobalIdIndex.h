@@ -0,0 +1,39 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GlobalId -> instance handle lookup table of one model.
+// Built once in a single pass over the model (or loaded from a sidecar file written by a previous run),
+// so that selecting k products costs k hash lookups instead of a scan over every instance.
+class GlobalIdIndex
+{
+public:
+    GlobalIdIndex() = default;
+    ~GlobalIdIndex() = default;
+
+    void build(OdIfcModel* pModel);
+
+    // The sidecar file stores a fingerprint of the source IFC file (its size and a hash of its head and tail, the
+    // head holds the FILE_NAME time stamp of the header), a stale index is rejected on load
+    bool load(const OdString& strIndexFilename, const OdString& strSourceFilename);
+    bool save(const OdString& strIndexFilename, const OdString& strSourceFilename) const;
+
+    OdDAIObjectId find(OdIfcModel* pModel, const std::string& globalId) const;
+
+    std::size_t size() const { return mHandles.size(); }
+
+    // One GlobalId per line, empty lines and lines starting with '#' are skipped
+    static std::vector<std::string> readGlobalIds(const OdString& strGuidFilename);
+
+private:
+    static OdUInt64 fileFingerprint(const OdString& strFilename);
+
+    std::unordered_map<std::string, OdUInt64> mHandles;
+};
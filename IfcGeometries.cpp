@@ -49,6 +49,20 @@
 
 #include "BrepGeometryModeler.h"
 #include "AttributeHelper.h"
+#include "GlobalIdIndex.h"
+#include "ProductTraversal.h"
+#include "ParallelProductConverter.h"
+#include "ParallelVectorizer.h"
+#include "BatchConverter.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "ScratchArena.h"
+#include "TriangleCapture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
 
 
 GS_TOOLKIT_EXPORT void odgsInitialize();
@@ -391,6 +405,198 @@ void dumpEntity(OdIfc::OdIfcInstance* inst, OdDAI::Entity* entityDef)
 }
 
 
+/************************************************************************/
+/* Conversion of one IFC file                                           */
+/************************************************************************/
+struct ConversionOptions
+{
+  std::vector<std::string> globalIds;
+  OdString strIndexFilename;
+  bool bAllProducts = false;
+  bool bParallel = false;
+  unsigned int nThreads = 0;
+  double weldTolerance = 1e-9;
+  DeviationPolicy deviationPolicy;
+  bool bPrimitiveOutput = false;
+  bool bPrettyOutput = false;
+  bool bBinaryOutput = false;
+  bool bStream = false;
+  std::string strCacheDirectory;
+  bool bVectorize = false;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point& start)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const double seconds = std::chrono::duration<double>(now - start).count();
+  start = now;
+  return seconds;
+}
+
+// Tessellates the products with the SDK vectorizer, the triangles of every product are captured in world space.
+// nThreads > 1 (or 0 for every CPU) draws partitions of the products through several devices concurrently.
+// With a triangle budget the products are vectorized again with scaled deviations until the triangle count is
+// within kBudgetSlack of the budget, or after kBudgetPasses passes
+static void vectorizeProducts(OdIfcFile* pDatabase, const std::vector<OdDAIObjectId>& productIds, unsigned int nThreads, const DeviationPolicy& deviationPolicy, TriangleCapture& capture)
+{
+  const int kBudgetPasses = 4;
+  const double kBudgetSlack = 0.1;
+  const double kMaxBudgetStep = 64.0;
+
+  if (productIds.empty())
+  {
+    BREP_LOG(Warning, "No product selected, nothing is vectorized.");
+    return;
+  }
+
+  {
+    BREP_PROFILE_SCOPE("composeEntities");
+    if (pDatabase->composeEntities() != eOk)
+    {
+      BREP_LOG(Warning, "Not every entity could be composed.");
+    }
+  }
+
+  DeviationPolicy passPolicy = deviationPolicy;
+  passPolicy.collectAggregates(pDatabase->getModel().get());
+  ParallelVectorizer parallelVectorizer(nThreads);
+  for (int pass = 0; ; ++pass)
+  {
+    TriangleCapture passCapture;
+    parallelVectorizer.vectorize(pDatabase, productIds, passPolicy, passCapture);
+    capture = std::move(passCapture);
+
+    const std::size_t budget = passPolicy.triangleBudget();
+    const double triangles = static_cast<double>(capture.triangleCount());
+    if (budget == 0 || triangles == 0.0 || pass + 1 == kBudgetPasses || std::fabs(triangles - budget) <= kBudgetSlack * budget)
+    {
+      break;
+    }
+
+    // The segments per circle of a curved surface go with the inverse square root of the deviation
+    const double ratio = triangles / budget;
+    const double step = std::max(1.0 / kMaxBudgetStep, std::min(ratio * ratio, kMaxBudgetStep));
+    BREP_LOG(Info, "Vectorization pass " << pass << ": " << capture.triangleCount() << " triangles, budget " << budget << ", deviation scale " << passPolicy.budgetScale() * step);
+    passPolicy.setBudgetScale(passPolicy.budgetScale() * step);
+  }
+}
+
+// Reads szSource, converts the selected products and writes them to strBrepFilename.
+// The database goes out of scope on return, nothing of the file stays loaded
+static void convertFile(MyServices& svcs, const OdString& szSource, const OdString& strBrepFilename, const ConversionOptions& options, BatchConverter::Result& result)
+{
+  std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+
+  OdIfcFilePtr pDatabase = svcs.createDatabase();
+  {
+    BREP_PROFILE_SCOPE("readFile");
+    if (pDatabase->readFile(szSource) != eOk)
+    {
+      throw OdError( eCantOpenFile );
+    }
+  }
+  result.readSeconds = secondsSince(stageStart);
+
+  BrepGeometryModeler brepGeometryModeler;
+  brepGeometryModeler.setWeldTolerance(options.weldTolerance);
+  brepGeometryModeler.setDeviationPolicy(options.deviationPolicy);
+  brepGeometryModeler.setPrimitiveOutput(options.bPrimitiveOutput);
+  brepGeometryModeler.setPrettyOutput(options.bPrettyOutput);
+  brepGeometryModeler.setOutputFormat(options.bBinaryOutput ? BrepOutputFormat::Binary : BrepOutputFormat::Json);
+
+  // Streamed products go to the spill files in product order as they are converted, so streaming converts serially.
+  // Cached fragments are spliced into the stream
+  bool bParallel = options.bParallel;
+  if ((options.bStream || !options.strCacheDirectory.empty()) && !options.bVectorize)
+  {
+    if (!brepGeometryModeler.beginStream(strBrepFilename))
+    {
+      throw OdError( eCantOpenFile );
+    }
+    if (bParallel)
+    {
+      BREP_LOG(Warning, "-stream and -cache convert the products serially, -mt is ignored.");
+      bParallel = false;
+    }
+  }
+  if (!options.strCacheDirectory.empty() && !options.bVectorize)
+  {
+    brepGeometryModeler.setFragmentCache(options.strCacheDirectory);
+  }
+
+  OdIfcModelPtr pModel = pDatabase->getModel();
+
+  std::vector<OdDAIObjectId> productIds;
+  if (options.bAllProducts)
+  {
+    ProductTraversal productTraversal(pModel);
+    productIds = productTraversal.collectProducts();
+  }
+  else
+  {
+    GlobalIdIndex globalIdIndex;
+    if (options.strIndexFilename.isEmpty() || !globalIdIndex.load(options.strIndexFilename, szSource))
+    {
+      globalIdIndex.build(pModel);
+      if (!options.strIndexFilename.isEmpty())
+      {
+        globalIdIndex.save(options.strIndexFilename, szSource);
+      }
+    }
+
+    for (const auto& globalId : options.globalIds)
+    {
+      OdDAIObjectId productId = globalIdIndex.find(pModel, globalId);
+      if (productId.isNull())
+      {
+        BREP_LOG(Warning, "Product " << globalId << " not found.");
+        continue;
+      }
+      productIds.push_back(productId);
+    }
+  }
+  result.productCount = productIds.size();
+
+  if (options.bVectorize)
+  {
+    TriangleCapture capture;
+    vectorizeProducts(pDatabase, productIds, options.bParallel ? options.nThreads : 1, options.deviationPolicy, capture);
+    result.convertSeconds = secondsSince(stageStart);
+    BREP_LOG(Info, "Vectorized " << capture.products().size() << " products, " << capture.triangleCount() << " triangles");
+    brepGeometryModeler.postProcessTriangles(capture, strBrepFilename);
+    result.writeSeconds = secondsSince(stageStart);
+    return;
+  }
+
+  {
+    BREP_PROFILE_SCOPE("convertProducts");
+    if (bParallel)
+    {
+      ParallelProductConverter parallelProductConverter(options.nThreads);
+      parallelProductConverter.convert(productIds, brepGeometryModeler);
+    }
+    else
+    {
+      for (std::size_t productIdx = 0; productIdx < productIds.size(); ++productIdx)
+      {
+        OdIfc::OdIfcInstancePtr pInst = productIds[productIdx].openObject();
+        if (pInst.isNull())
+        {
+          continue;
+        }
+
+        // Don't dump --> dumpEntity(pInst, pInst->getInstanceType());
+        brepGeometryModeler.addProduct(pInst, productIdx);
+      }
+    }
+  }
+  result.convertSeconds = secondsSince(stageStart);
+
+  brepGeometryModeler.postProcessGeometries(strBrepFilename); // BC!!! not only the front element, process all elements
+  result.writeSeconds = secondsSince(stageStart);
+}
+
+
 /************************************************************************/
 /* Main                                                                 */
 /************************************************************************/
@@ -418,101 +624,235 @@ int main(int argc, char* argv[])
 
   if (bInvalidArgs)    
   {
-    odPrintConsoleString(OD_T("\n\tusage: ExIfcVectorize <filename> [stlFilename] [-DO]"));
-    odPrintConsoleString(OD_T("\n\t-DO disables progress meter output.\n"));
+    odPrintConsoleString(OD_T("\n\tusage: ExIfcVectorize <filename> [brepFilename] [-DO] [-guid <GlobalId>]... [-guids <guidListFilename>] [-index <indexFilename>] [-all] [-mt <threads>] [-weld <tolerance>] [-quality <factor>] [-lods <count>] [-primitives] [-pretty] [-binary] [-stream] [-cache <directory>] [-vectorize] [-budget <triangles>] [-log <level>] [-profile <reportFilename>] [-trace <traceFilename>] [-noarena]"));
+    odPrintConsoleString(OD_T("\n\t       ExIfcVectorize -batch <manifestFilename> [-summary <summaryFilename>] [-workers <count>] [options]"));
+    odPrintConsoleString(OD_T("\n\t-DO disables progress meter output."));
+    odPrintConsoleString(OD_T("\n\t-guid selects a product by GlobalId, can be repeated."));
+    odPrintConsoleString(OD_T("\n\t-guids selects the products listed in a file, one GlobalId per line."));
+    odPrintConsoleString(OD_T("\n\t-index loads the GlobalId index from a sidecar file, or builds and saves it there."));
+    odPrintConsoleString(OD_T("\n\t-all converts every product that has a representation, walking the IfcProduct type extents."));
+    odPrintConsoleString(OD_T("\n\t-mt converts (or with -vectorize draws) the products on the thread pool, 0 threads uses every CPU."));
+    odPrintConsoleString(OD_T("\n\t-weld merges vertices closer than the tolerance (default 1e-9)."));
+    odPrintConsoleString(OD_T("\n\t-quality scales the segments of the swept solids, the deviation follows the profile size (default 1)."));
+    odPrintConsoleString(OD_T("\n\t-lods writes that many levels of detail of the swept solids (default 1)."));
+    odPrintConsoleString(OD_T("\n\t-primitives writes circular and polygonal extrusions as analytic records instead of facets."));
+    odPrintConsoleString(OD_T("\n\t-pretty indents the BREP json, it is compact by default."));
+    odPrintConsoleString(OD_T("\n\t-binary writes the memory mappable binary BREP format instead of json."));
+    odPrintConsoleString(OD_T("\n\t-stream writes every product to spill files as it is converted, keeping one product in memory."));
+    odPrintConsoleString(OD_T("\n\t-cache reuses the products whose representation is unchanged from a fragment cache directory, implies -stream."));
+    odPrintConsoleString(OD_T("\n\t-vectorize tessellates the selected products with the SDK vectorizer and writes their triangles."));
+    odPrintConsoleString(OD_T("\n\t-budget vectorizes again with scaled deviations until the products have about that many triangles."));
+    odPrintConsoleString(OD_T("\n\t-log sets the verbosity: off, error, warning (default), info, debug or trace."));
+    odPrintConsoleString(OD_T("\n\t-profile writes the stage timings and counters as json."));
+    odPrintConsoleString(OD_T("\n\t-trace writes a Chrome trace event file with the stage spans of every thread."));
+    odPrintConsoleString(OD_T("\n\t-noarena allocates the arena temporaries on the heap, to compare scratchAllocations and scratchHeapAllocations with and without the arena."));
+    odPrintConsoleString(OD_T("\n\t-batch converts the input/output filename pairs of a manifest, one pair per line, initialising the SDK once."));
+    odPrintConsoleString(OD_T("\n\t-summary writes the status and timings of every batch file as json (default <manifestFilename>.summary.json)."));
+    odPrintConsoleString(OD_T("\n\t-workers converts that many batch files at a time on the thread pool, 0 uses every CPU (default 1).\n"));
     return nRes;
   }
 
-  OdString szSource = argv[1];
+  OdString szSource = OdString::kEmpty;
   OdString strBrepFilename = OdString::kEmpty;
+  ConversionOptions options;
+  std::string strManifestFilename;
+  std::string strSummaryFilename;
+  unsigned int nWorkers = 1;
+  std::string strProfileFilename;
+  std::string strTraceFilename;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    OdString strArg = argv[i];
+    if (strArg == OD_T("-DO"))
+    {
+      continue;
+    }
+    if (strArg == OD_T("-guid") && i + 1 < argc)
+    {
+      options.globalIds.push_back(OdAnsiString(OdString(argv[++i])).c_str());
+    }
+    else if (strArg == OD_T("-guids") && i + 1 < argc)
+    {
+      std::vector<std::string> fileGlobalIds = GlobalIdIndex::readGlobalIds(argv[++i]);
+      options.globalIds.insert(options.globalIds.end(), fileGlobalIds.begin(), fileGlobalIds.end());
+    }
+    else if (strArg == OD_T("-all"))
+    {
+      options.bAllProducts = true;
+    }
+    else if (strArg == OD_T("-mt") && i + 1 < argc)
+    {
+      options.bParallel = true;
+      options.nThreads = (unsigned int)odStrToInt(OdString(argv[++i]));
+    }
+    else if (strArg == OD_T("-pretty"))
+    {
+      options.bPrettyOutput = true;
+    }
+    else if (strArg == OD_T("-binary"))
+    {
+      options.bBinaryOutput = true;
+    }
+    else if (strArg == OD_T("-primitives"))
+    {
+      options.bPrimitiveOutput = true;
+    }
+    else if (strArg == OD_T("-stream"))
+    {
+      options.bStream = true;
+    }
+    else if (strArg == OD_T("-vectorize"))
+    {
+      options.bVectorize = true;
+    }
+    else if (strArg == OD_T("-cache") && i + 1 < argc)
+    {
+      options.strCacheDirectory = OdAnsiString(OdString(argv[++i])).c_str();
+    }
+    else if (strArg == OD_T("-weld") && i + 1 < argc)
+    {
+      options.weldTolerance = odStrToD(OdString(argv[++i]));
+    }
+    else if (strArg == OD_T("-quality") && i + 1 < argc)
+    {
+      options.deviationPolicy.setQuality(odStrToD(OdString(argv[++i])));
+    }
+    else if (strArg == OD_T("-budget") && i + 1 < argc)
+    {
+      options.deviationPolicy.setTriangleBudget((std::size_t)odStrToInt(OdString(argv[++i])));
+    }
+    else if (strArg == OD_T("-lods") && i + 1 < argc)
+    {
+      options.deviationPolicy.setLodCount((unsigned int)odStrToInt(OdString(argv[++i])));
+    }
+    else if (strArg == OD_T("-log") && i + 1 < argc)
+    {
+      LogLevel logLevel;
+      if (Log::parseLevel(OdAnsiString(OdString(argv[++i])).c_str(), logLevel))
+      {
+        Log::setLevel(logLevel);
+      }
+    }
+    else if (strArg == OD_T("-profile") && i + 1 < argc)
+    {
+      strProfileFilename = OdAnsiString(OdString(argv[++i])).c_str();
+    }
+    else if (strArg == OD_T("-trace") && i + 1 < argc)
+    {
+      strTraceFilename = OdAnsiString(OdString(argv[++i])).c_str();
+    }
+    else if (strArg == OD_T("-noarena"))
+    {
+      ScratchArena::setEnabled(false);
+    }
+    else if (strArg == OD_T("-index") && i + 1 < argc)
+    {
+      options.strIndexFilename = argv[++i];
+    }
+    else if (strArg == OD_T("-batch") && i + 1 < argc)
+    {
+      strManifestFilename = OdAnsiString(OdString(argv[++i])).c_str();
+    }
+    else if (strArg == OD_T("-summary") && i + 1 < argc)
+    {
+      strSummaryFilename = OdAnsiString(OdString(argv[++i])).c_str();
+    }
+    else if (strArg == OD_T("-workers") && i + 1 < argc)
+    {
+      nWorkers = (unsigned int)odStrToInt(OdString(argv[++i]));
+    }
+    else if (szSource.isEmpty())
+    {
+      szSource = strArg;
+    }
+    else if (strBrepFilename.isEmpty())
+    {
+      strBrepFilename = strArg;
+    }
+  }
 
-  if (argc > 2)
+  if (szSource.isEmpty() && strManifestFilename.empty())
   {
-    strBrepFilename = argv[2];
-    if (strBrepFilename == OD_T("-DO"))
-      strBrepFilename = OdString::kEmpty;
+    odPrintConsoleString(OD_T("\n\tNo input file or -batch manifest given.\n"));
+    return 1;
+  }
+
+  // Without a selection a single file converts the sample product, a batch converts every product of each file
+  if (options.globalIds.empty() && !options.bAllProducts)
+  {
+    if (strManifestFilename.empty())
+    {
+      options.globalIds.push_back("0f7I2_mxX3JOk$Z$4oj$LI");
+    }
+    else
+    {
+      options.bAllProducts = true;
+    }
   }
 
 #if !defined(_TOOLKIT_IN_DLL_)
   ODRX_INIT_STATIC_MODULE_MAP();
 #endif
 
+  if (!strProfileFilename.empty() || !strTraceFilename.empty())
+  {
+    Profiler::enable(!strTraceFilename.empty());
+  }
+
+  // Initialised once, also for all the files of a batch
   odrxInitialize(&svcs);
   odgsInitialize();
   odIfcInitialize(false /* No CDA */, true);
 
   try
   {
-    OdIfcFilePtr pDatabase = svcs.createDatabase();
-    
-    if (pDatabase->readFile(szSource) != eOk)
-    {
-      throw OdError( eCantOpenFile );
-    }
+    BREP_PROFILE_SCOPE("total");
 
-    BrepGeometryModeler brepGeometryModeler;
-
-    OdIfcModelPtr pModel = pDatabase->getModel();
-    OdDAI::InstanceIteratorPtr it = pModel->newIterator();
-    OdIfc::OdIfcInstancePtr pInst;
-    unsigned int entIdx;
-    for (entIdx = 0; !it->done(); it->step(), ++entIdx)
+    if (!strManifestFilename.empty())
     {
-        // Opens an instance
-        pInst = it->id().openObject();
-
-        if (!pInst.isNull())
+      std::vector<BatchConverter::Job> jobs;
+      if (!BatchConverter::readManifest(strManifestFilename, jobs))
+      {
+        throw OdError(eCantOpenFile);
+      }
+
+      // The files are the unit of parallelism with several workers, and a sidecar index belongs to a single file
+      ConversionOptions fileOptions = options;
+      fileOptions.bParallel = fileOptions.bParallel && nWorkers == 1;
+      fileOptions.strIndexFilename = OdString::kEmpty;
+
+      BatchConverter batchConverter(nWorkers);
+      batchConverter.run(jobs, [&svcs, &fileOptions](const BatchConverter::Job& job, BatchConverter::Result& result)
         {
-            const char* globalid;
-            pInst->getAttr("globalid") >> globalid;
-            OdString strGlobalid = globalid;
-            if (strGlobalid != "0f7I2_mxX3JOk$Z$4oj$LI") continue;
-
-            // Don't dump --> dumpEntity(pInst, pInst->getInstanceType());
-
-            OdIfc::OdIfcInstancePtr objectPlacement = AttributeHelper::getAttributeAsInstance(pInst, "objectplacement");
-                OdIfc::OdIfcInstancePtr relativePlacement = AttributeHelper::getAttributeAsInstance(objectPlacement, "relativeplacement");
-                    OdIfc::OdIfcInstancePtr location = AttributeHelper::getAttributeAsInstance(relativePlacement, "location");
-                    OdIfc::OdIfcInstancePtr axis = AttributeHelper::getAttributeAsInstance(relativePlacement, "axis");
-                    OdIfc::OdIfcInstancePtr refdirection = AttributeHelper::getAttributeAsInstance(relativePlacement, "refdirection");
-                    {
-                        OdGeVector3d coordinates = AttributeHelper::getVector<OdGeVector3d>(location, "coordinates");
-                        OdGeVector3d directionratiosAxis = AttributeHelper::getVector<OdGeVector3d>(axis, "directionratios");
-                        OdGeVector3d directionratiosRefdirection = AttributeHelper::getVector<OdGeVector3d>(refdirection, "directionratios");
-                        // Don't dump --> std::cout << coordinates.x << " , " << coordinates.y << " , " << coordinates.z << std::endl;
-                        // Don't dump --> std::cout << directionratiosAxis.x << " , " << directionratiosAxis.y << " , " << directionratiosAxis.z << std::endl;
-                        // Don't dump --> std::cout << directionratiosRefdirection.x << " , " << directionratiosRefdirection.y << " , " << directionratiosRefdirection.z << std::endl;
-                    }
-
-            OdIfc::OdIfcInstancePtr representation = AttributeHelper::getAttributeAsInstance(pInst, "representation");                                          // Don't dump --> dumpEntity(representation, representation->getInstanceType());
-                std::vector<OdIfc::OdIfcInstancePtr> representations = AttributeHelper::getAttributeAsInstanceVector(representation, "representations");            // Don't dump --> dumpEntity(representations[0], representations[0]->getInstanceType());
-                    std::vector<OdIfc::OdIfcInstancePtr> items = AttributeHelper::getAttributeAsInstanceVector(representations[0], "items");                            // Don't dump --> dumpEntity(items[0], items[0]->getInstanceType());
-                        // Surface Model
-                        {
-                            OdIfc::OdIfcInstancePtr mappingsource = AttributeHelper::getAttributeAsInstance(items[0], "mappingsource");                                         // Don't dump --> dumpEntity(mappingsource, mappingsource->getInstanceType());
-                            OdIfc::OdIfcInstancePtr mappedrepresentation = AttributeHelper::getAttributeAsInstance(mappingsource, "mappedrepresentation");                      // Don't dump --> dumpEntity(mappedrepresentation, mappedrepresentation->getInstanceType());
-                            std::vector<OdIfc::OdIfcInstancePtr> mappedItems = AttributeHelper::getAttributeAsInstanceVector(mappedrepresentation, "items");
-                            for (const auto& mappedItem : mappedItems)
-                            {
-                                brepGeometryModeler.addMappedItemAsSurface(mappedItem);
-                            }
-                        }
-                        // SweptSolid
-                        {
-                            OdIfc::OdIfcInstancePtr mappingsource = AttributeHelper::getAttributeAsInstance(items[1], "mappingsource");
-                            OdIfc::OdIfcInstancePtr mappedrepresentation = AttributeHelper::getAttributeAsInstance(mappingsource, "mappedrepresentation");
-                            std::vector<OdIfc::OdIfcInstancePtr> mappedItems = AttributeHelper::getAttributeAsInstanceVector(mappedrepresentation, "items");
-                            for (const auto& mappedItem : mappedItems)
-                            {
-                                brepGeometryModeler.addMappedItemAsSolid(mappedItem);
-                            }
-                        }
-            std::cout << "length of items: " << items.size() << std::endl;
-        }
+          // The manifest is UTF-8
+          convertFile(svcs, OdString(job.input.c_str(), CP_UTF_8), OdString(job.output.c_str(), CP_UTF_8), fileOptions, result);
+        });
+
+      if (strSummaryFilename.empty())
+      {
+        strSummaryFilename = strManifestFilename + ".summary.json";
+      }
+      if (!batchConverter.writeSummary(strSummaryFilename, jobs))
+      {
+        BREP_LOG(Error, "Can't write the batch summary " << strSummaryFilename);
+      }
+      BREP_LOG(Info, "Batch: " << jobs.size() << " files, " << batchConverter.failedCount() << " failed");
+      nRes = batchConverter.failedCount() == 0 ? 0 : 2;
+    }
+    else
+    {
+      BatchConverter::Result result;
+      convertFile(svcs, szSource, strBrepFilename, options, result);
     }
 
-    brepGeometryModeler.postProcessGeometries(strBrepFilename); // BC!!! not only the front element, process all elements
-    
+    if (Profiler::isEnabled())
+    {
+      AttributeHelper::CacheStats attributeCacheStats = AttributeHelper::cacheStats();
+      BREP_LOG(Info, "Attribute cache: " << attributeCacheStats.hits << " hits, " << attributeCacheStats.misses << " misses");
+      Profiler::setExtraCounter("attributeCacheHits", attributeCacheStats.hits);
+      Profiler::setExtraCounter("attributeCacheMisses", attributeCacheStats.misses);
+    }
   }
   catch (OdError& e)
   {
@@ -526,6 +866,17 @@ int main(int argc, char* argv[])
     throw;
   }
 
+  if (!strProfileFilename.empty() && !Profiler::writeReport(strProfileFilename))
+  {
+    BREP_LOG(Error, "Can't write the profile report " << strProfileFilename);
+  }
+  if (!strTraceFilename.empty() && !Profiler::writeTrace(strTraceFilename))
+  {
+    BREP_LOG(Error, "Can't write the trace " << strTraceFilename);
+  }
+
+  Log::flush();
+
   odIfcUninitialize();
   odgsUninitialize();
   odrxUninitialize();
@@ -0,0 +1,224 @@
+#include "Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const std::size_t kRingCapacity = 1 << 16;
+    const std::chrono::milliseconds kFlushInterval(50);
+
+    // Single producer (the owning thread), single consumer (the flush thread)
+    struct RingBuffer
+    {
+        char data[kRingCapacity];
+        std::atomic<std::uint64_t> head{ 0 };   // written by the producer
+        std::atomic<std::uint64_t> tail{ 0 };   // written by the consumer
+    };
+
+    class LogSink
+    {
+    public:
+        static LogSink& instance()
+        {
+            static LogSink sink;
+            return sink;
+        }
+
+        ~LogSink()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStop = true;
+            }
+            mWakeUp.notify_one();
+            if (mThread.joinable())
+            {
+                mThread.join();
+            }
+            drain();
+        }
+
+        std::shared_ptr<RingBuffer> registerThread()
+        {
+            std::shared_ptr<RingBuffer> ring = std::make_shared<RingBuffer>();
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRings.push_back(ring);
+            if (!mThread.joinable())
+            {
+                mThread = std::thread(&LogSink::run, this);
+            }
+            return ring;
+        }
+
+        void wakeUp()
+        {
+            mWakeUp.notify_one();
+        }
+
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            const std::uint64_t target = ++mFlushRequests;
+            mWakeUp.notify_one();
+            mFlushed.wait(lock, [&]() { return mFlushesDone >= target || !mThread.joinable(); });
+        }
+
+    private:
+        LogSink() = default;
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mStop)
+            {
+                mWakeUp.wait_for(lock, kFlushInterval);
+                const std::uint64_t requests = mFlushRequests;
+                lock.unlock();
+                drain();
+                lock.lock();
+                mFlushesDone = requests;
+                mFlushed.notify_all();
+            }
+        }
+
+        void drain()
+        {
+            std::vector<std::shared_ptr<RingBuffer>> rings;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                rings = mRings;
+            }
+
+            bool written = false;
+            for (const auto& ring : rings)
+            {
+                const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+                std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                while (tail != head)
+                {
+                    const std::size_t start = static_cast<std::size_t>(tail % kRingCapacity);
+                    const std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(head - tail, kRingCapacity - start));
+                    std::fwrite(ring->data + start, 1, length, stdout);
+                    tail += length;
+                    written = true;
+                }
+                ring->tail.store(tail, std::memory_order_release);
+            }
+            if (written)
+            {
+                std::fflush(stdout);
+            }
+
+            // A ring referenced only by mRings and the copy above belongs to a finished thread, drop it once it is empty
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRings.erase(std::remove_if(mRings.begin(), mRings.end(), [](const std::shared_ptr<RingBuffer>& ring)
+            {
+                return ring.use_count() <= 2 && ring->head.load() == ring->tail.load();
+            }), mRings.end());
+        }
+
+        std::mutex mMutex;
+        std::condition_variable mWakeUp;
+        std::condition_variable mFlushed;
+        std::vector<std::shared_ptr<RingBuffer>> mRings;
+        std::thread mThread;
+        std::uint64_t mFlushRequests = 0;
+        std::uint64_t mFlushesDone = 0;
+        bool mStop = false;
+    };
+
+    struct ThreadLog
+    {
+        std::shared_ptr<RingBuffer> ring = LogSink::instance().registerThread();
+        std::ostringstream stream;
+    };
+
+    ThreadLog& threadLog()
+    {
+        thread_local ThreadLog log;
+        return log;
+    }
+
+    const char* const kLevelNames[] = { "off", "error", "warning", "info", "debug", "trace" };
+}
+
+int Log::sLevel = static_cast<int>(LogLevel::Warning);
+
+bool Log::parseLevel(const char* name, LogLevel& level)
+{
+    for (int i = 0; i < static_cast<int>(sizeof(kLevelNames) / sizeof(kLevelNames[0])); ++i)
+    {
+        if (std::strcmp(name, kLevelNames[i]) == 0 || (name[0] == '0' + i && name[1] == '\0'))
+        {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Log::flush()
+{
+    threadLog();
+    LogSink::instance().flush();
+}
+
+Log::Line::Line(LogLevel level)
+    : mStream(threadLog().stream)
+{
+    mStream.str(std::string());
+    if (level == LogLevel::Error)
+    {
+        mStream << "Error: ";
+    }
+    else if (level == LogLevel::Warning)
+    {
+        mStream << "Warning: ";
+    }
+}
+
+Log::Line::~Line()
+{
+    mStream << '\n';
+    const std::string text = mStream.str();
+    write(text.data(), text.size());
+}
+
+void Log::write(const char* text, std::size_t length)
+{
+    RingBuffer& ring = *threadLog().ring;
+    length = std::min(length, kRingCapacity);
+
+    // Wait for the flush thread when the ring is full, messages are never dropped
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    while (kRingCapacity - (head - ring.tail.load(std::memory_order_acquire)) < length)
+    {
+        LogSink::instance().wakeUp();
+        std::this_thread::yield();
+    }
+
+    for (std::size_t written = 0; written < length; )
+    {
+        const std::size_t start = static_cast<std::size_t>((head + written) % kRingCapacity);
+        const std::size_t chunk = std::min(length - written, kRingCapacity - start);
+        std::memcpy(ring.data + start, text + written, chunk);
+        written += chunk;
+    }
+    ring.head.store(head + length, std::memory_order_release);
+
+    if (kRingCapacity - (head + length - ring.tail.load(std::memory_order_relaxed)) < kRingCapacity / 2)
+    {
+        LogSink::instance().wakeUp();
+    }
+}
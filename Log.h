@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <sstream>
+
+// Leveled logging. Messages are formatted on the calling thread into its own ring buffer, a background thread
+// drains the ring buffers to stdout, so logging doesn't flush the console on the geometry threads.
+//
+//   BREP_LOG(Debug, "\tradius = " << r);
+//
+// The message is only formatted if the level is enabled at compile time (BREP_LOG_MAX_LEVEL) and at run time
+// (Log::setLevel), a disabled message costs a compare.
+enum class LogLevel
+{
+    Off = 0,
+    Error = 1,
+    Warning = 2,
+    Info = 3,
+    Debug = 4,
+    Trace = 5
+};
+
+// Highest level compiled in, messages above it are removed by the compiler
+#ifndef BREP_LOG_MAX_LEVEL
+#define BREP_LOG_MAX_LEVEL 4
+#endif
+
+class Log
+{
+public:
+    static bool isEnabled(LogLevel level)
+    {
+        return static_cast<int>(level) <= BREP_LOG_MAX_LEVEL && static_cast<int>(level) <= sLevel;
+    }
+
+    static LogLevel level() { return static_cast<LogLevel>(sLevel); }
+    static void setLevel(LogLevel level) { sLevel = static_cast<int>(level); }
+
+    // Parses "off", "error", "warning", "info", "debug", "trace" or the level number, false if unknown
+    static bool parseLevel(const char* name, LogLevel& level);
+
+    // Blocks until everything logged so far is written
+    static void flush();
+
+    // Formats one message into the ring buffer of the calling thread
+    class Line
+    {
+    public:
+        explicit Line(LogLevel level);
+        ~Line();
+
+        Line(const Line&) = delete;
+        Line& operator=(const Line&) = delete;
+
+        std::ostream& stream() { return mStream; }
+
+    private:
+        std::ostringstream& mStream;
+    };
+
+private:
+    static void write(const char* text, std::size_t length);
+
+    static int sLevel;
+};
+
+#define BREP_LOG(level, message) \
+    do \
+    { \
+        if (Log::isEnabled(LogLevel::level)) \
+        { \
+            Log::Line brepLogLine(LogLevel::level); \
+            brepLogLine.stream() << message; \
+        } \
+    } while (0)
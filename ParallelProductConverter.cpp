@@ -0,0 +1,145 @@
+#include "ParallelProductConverter.h"
+
+#include "StaticRxObject.h"
+#include "RxDynamicModule.h"
+#include "RxThreadPoolService.h"
+#include "ThreadsCounter.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    // Products pulled from the shared cursor at once, keeps the cursor contention low on small products
+    const std::size_t kProductBatchSize = 16;
+
+    // First exception thrown on a worker, rethrown on the calling thread. The other workers stop at their next batch
+    struct WorkerError
+    {
+        std::mutex mutex;
+        std::exception_ptr exception;
+        std::atomic<bool> bFailed{ false };
+
+        void set(std::exception_ptr e)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!exception)
+            {
+                exception = e;
+            }
+            bFailed = true;
+        }
+    };
+
+    class ProductConversionTask : public OdApcAtom
+    {
+    public:
+        void init(const std::vector<OdDAIObjectId>* pProductIds, std::atomic<std::size_t>* pNextProductIdx, BrepGeometryModeler* pShard, WorkerError* pError)
+        {
+            mProductIds = pProductIds;
+            mNextProductIdx = pNextProductIdx;
+            mShard = pShard;
+            mError = pError;
+        }
+
+        void apcEntryPoint(OdApcParamType /*parameter*/) override
+        {
+            // Nothing may escape a thread pool atom
+            try
+            {
+                convertBatches();
+            }
+            catch (...)
+            {
+                mError->set(std::current_exception());
+            }
+        }
+
+    private:
+        void convertBatches()
+        {
+            const std::size_t productCount = mProductIds->size();
+            while (!mError->bFailed)
+            {
+                const std::size_t first = mNextProductIdx->fetch_add(kProductBatchSize);
+                if (first >= productCount)
+                {
+                    break;
+                }
+
+                const std::size_t last = std::min(first + kProductBatchSize, productCount);
+                for (std::size_t productIdx = first; productIdx < last; ++productIdx)
+                {
+                    OdIfc::OdIfcInstancePtr pInst = (*mProductIds)[productIdx].openObject();
+                    if (!pInst.isNull())
+                    {
+                        mShard->addProduct(pInst, productIdx);
+                    }
+                }
+            }
+        }
+
+        const std::vector<OdDAIObjectId>* mProductIds = nullptr;
+        std::atomic<std::size_t>* mNextProductIdx = nullptr;
+        BrepGeometryModeler* mShard = nullptr;
+        WorkerError* mError = nullptr;
+    };
+}
+
+ParallelProductConverter::ParallelProductConverter(unsigned int nThreads)
+    : mThreads(nThreads)
+{
+}
+
+void ParallelProductConverter::convert(const std::vector<OdDAIObjectId>& productIds, BrepGeometryModeler& brepGeometryModeler)
+{
+    OdRxThreadPoolServicePtr pThreadPool = odrxDynamicLinker()->loadApp(OdThreadPoolModuleName);
+    unsigned int nThreads = mThreads;
+    if (!pThreadPool.isNull() && nThreads == 0)
+    {
+        nThreads = pThreadPool->numCPUs();
+    }
+
+    // Without a thread pool (or with a single worker) fall back to the serial conversion
+    if (pThreadPool.isNull() || nThreads < 2 || productIds.size() < 2)
+    {
+        for (std::size_t productIdx = 0; productIdx < productIds.size(); ++productIdx)
+        {
+            OdIfc::OdIfcInstancePtr pInst = productIds[productIdx].openObject();
+            if (!pInst.isNull())
+            {
+                brepGeometryModeler.addProduct(pInst, productIdx);
+            }
+        }
+        return;
+    }
+
+    std::vector<BrepGeometryModeler> shards;
+    shards.reserve(nThreads);
+    for (unsigned int i = 0; i < nThreads; ++i)
+    {
+        shards.push_back(brepGeometryModeler.createShard());
+    }
+    std::vector<std::unique_ptr<OdStaticRxObject<ProductConversionTask>>> tasks;
+    std::atomic<std::size_t> nextProductIdx(0);
+    WorkerError error;
+
+    OdApcQueuePtr pQueue = pThreadPool->newMTQueue(ThreadsCounter::kMtLoadingAttributes | ThreadsCounter::kMtRegenAttributes, nThreads);
+    for (unsigned int i = 0; i < nThreads; ++i)
+    {
+        tasks.emplace_back(new OdStaticRxObject<ProductConversionTask>());
+        tasks.back()->init(&productIds, &nextProductIdx, &shards[i], &error);
+        pQueue->addEntryPoint(tasks.back().get(), 0);
+    }
+    pQueue->wait();
+
+    // Fails like the serial conversion would
+    if (error.exception)
+    {
+        std::rethrow_exception(error.exception);
+    }
+
+    brepGeometryModeler.mergeShards(shards);
+}
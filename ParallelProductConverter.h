@@ -0,0 +1,28 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include "BrepGeometryModeler.h"
+
+#include <vector>
+
+// Converts products on the OdRxThreadPoolService.
+// Every worker owns a BrepGeometryModeler shard and pulls small batches of products from a shared cursor until the
+// selection is exhausted, so fast workers take over the remaining work of slow ones. The shards are merged by
+// product index afterwards, the output is the same as a serial conversion.
+// The first error thrown on a worker stops the conversion and is rethrown by convert(), as the serial loop would.
+class ParallelProductConverter
+{
+public:
+    // nThreads == 0 uses one worker per CPU reported by the thread pool
+    explicit ParallelProductConverter(unsigned int nThreads = 0);
+    ~ParallelProductConverter() = default;
+
+    void convert(const std::vector<OdDAIObjectId>& productIds, BrepGeometryModeler& brepGeometryModeler);
+
+private:
+    unsigned int mThreads;
+};
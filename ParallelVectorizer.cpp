@@ -0,0 +1,155 @@
+#include "ParallelVectorizer.h"
+
+#include "StaticRxObject.h"
+#include "RxDynamicModule.h"
+#include "RxThreadPoolService.h"
+#include "ThreadsCounter.h"
+
+#include "IfcGsManager.h"
+#include "IfcGiContext.h"
+#include "Gs/Gs.h"
+
+#include "ExGsSimpleDevice.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+namespace
+{
+    // Draws the products through a device of their own, the triangles go to capture
+    void vectorizePartition(OdIfcFile* pDatabase, const std::vector<OdUInt64>& handles, const DeviationPolicy& deviationPolicy, TriangleCapture& capture)
+    {
+        BREP_PROFILE_SCOPE("vectorize");
+        OdGsDevicePtr pDevice = ExGsSimpleDevice::createObject(ExGsSimpleDevice::k3dDevice, &capture);
+        static_cast<ExGsSimpleDevice*>(pDevice.get())->setProductSelection(handles);
+        static_cast<ExGsSimpleDevice*>(pDevice.get())->setDeviationPolicy(&deviationPolicy);
+
+        OdGiContextForIfcDatabasePtr pIfcContext = OdGiContextForIfcDatabase::createObject();
+        pIfcContext->setDatabase(pDatabase);
+        // Without a GS model cache every triangle reaches the capture while its product is being drawn
+        pIfcContext->enableGsModel(false);
+        pDevice = OdIfcGsManager::setupActiveLayoutViews(pDevice, pIfcContext);
+
+        // Shaded views hand the shells to the conveyor as faces, wireframe ones as edges only
+        for (int viewIdx = 0; viewIdx < pDevice->numViews(); ++viewIdx)
+        {
+            pDevice->viewAt(viewIdx)->setMode(OdGsView::kGouraudShaded);
+        }
+        pDevice->onSize(OdGsDCRect(0, 100, 0, 100));
+        pDevice->update();
+    }
+
+    class PartitionVectorizationTask : public OdApcAtom
+    {
+    public:
+        void init(OdIfcFile* pDatabase, const std::vector<OdUInt64>* pHandles, const DeviationPolicy* pDeviationPolicy, TriangleCapture* pCapture)
+        {
+            mDatabase = pDatabase;
+            mHandles = pHandles;
+            mDeviationPolicy = pDeviationPolicy;
+            mCapture = pCapture;
+        }
+
+        void apcEntryPoint(OdApcParamType /*parameter*/) override
+        {
+            vectorizePartition(mDatabase, *mHandles, *mDeviationPolicy, *mCapture);
+        }
+
+    private:
+        OdIfcFile* mDatabase = nullptr;
+        const std::vector<OdUInt64>* mHandles = nullptr;
+        const DeviationPolicy* mDeviationPolicy = nullptr;
+        TriangleCapture* mCapture = nullptr;
+    };
+}
+
+ParallelVectorizer::ParallelVectorizer(unsigned int nThreads)
+    : mThreads(nThreads)
+{
+}
+
+void ParallelVectorizer::vectorize(OdIfcFile* pDatabase, const std::vector<OdDAIObjectId>& productIds, const DeviationPolicy& deviationPolicy, TriangleCapture& capture)
+{
+    // An empty selection would draw every product of the file
+    if (productIds.empty())
+    {
+        return;
+    }
+
+    OdRxThreadPoolServicePtr pThreadPool = odrxDynamicLinker()->loadApp(OdThreadPoolModuleName);
+    unsigned int nThreads = mThreads;
+    if (!pThreadPool.isNull() && nThreads == 0)
+    {
+        nThreads = pThreadPool->numCPUs();
+    }
+
+    // Without a thread pool (or with a single worker) one device draws every product
+    if (pThreadPool.isNull() || nThreads < 2 || productIds.size() < 2)
+    {
+        nThreads = 1;
+    }
+    else
+    {
+        nThreads = static_cast<unsigned int>(std::min<std::size_t>(nThreads, productIds.size()));
+    }
+
+    std::vector<std::vector<OdUInt64>> partitions(nThreads);
+    for (std::size_t productIdx = 0; productIdx < productIds.size(); ++productIdx)
+    {
+        partitions[productIdx % partitions.size()].push_back((OdUInt64)productIds[productIdx].getHandle());
+    }
+
+    std::vector<TriangleCapture> captures(partitions.size());
+    if (partitions.size() == 1)
+    {
+        vectorizePartition(pDatabase, partitions.front(), deviationPolicy, captures.front());
+    }
+    else
+    {
+        std::vector<std::unique_ptr<OdStaticRxObject<PartitionVectorizationTask>>> tasks;
+        OdApcQueuePtr pQueue = pThreadPool->newMTQueue(ThreadsCounter::kMtLoadingAttributes | ThreadsCounter::kMtRegenAttributes, nThreads);
+        for (std::size_t partitionIdx = 0; partitionIdx < partitions.size(); ++partitionIdx)
+        {
+            tasks.emplace_back(new OdStaticRxObject<PartitionVectorizationTask>());
+            tasks.back()->init(pDatabase, &partitions[partitionIdx], &deviationPolicy, &captures[partitionIdx]);
+            pQueue->addEntryPoint(tasks.back().get(), 0);
+        }
+        pQueue->wait();
+    }
+
+    // The devices draw in database order, the products are merged in selection order so that the output doesn't
+    // depend on the number of workers
+    BREP_PROFILE_SCOPE("mergeCaptures");
+    std::unordered_map<OdUInt64, std::size_t> selectionOrder;
+    selectionOrder.reserve(productIds.size());
+    for (std::size_t productIdx = 0; productIdx < productIds.size(); ++productIdx)
+    {
+        selectionOrder.emplace((OdUInt64)productIds[productIdx].getHandle(), productIdx);
+    }
+
+    struct CapturedProduct
+    {
+        std::size_t selectionIdx;
+        std::size_t partitionIdx;
+        std::size_t productIdx;
+    };
+    std::vector<CapturedProduct> products;
+    for (std::size_t partitionIdx = 0; partitionIdx < captures.size(); ++partitionIdx)
+    {
+        const std::vector<TriangleCapture::Product>& partitionProducts = captures[partitionIdx].products();
+        for (std::size_t productIdx = 0; productIdx < partitionProducts.size(); ++productIdx)
+        {
+            auto it = selectionOrder.find(partitionProducts[productIdx].handle);
+            products.push_back({ it != selectionOrder.end() ? it->second : productIds.size(), partitionIdx, productIdx });
+        }
+    }
+    std::stable_sort(products.begin(), products.end(),
+        [](const CapturedProduct& lhs, const CapturedProduct& rhs) { return lhs.selectionIdx < rhs.selectionIdx; });
+
+    for (const CapturedProduct& product : products)
+    {
+        capture.appendProduct(captures[product.partitionIdx], product.productIdx);
+    }
+}
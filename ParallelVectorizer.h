@@ -0,0 +1,30 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include "TriangleCapture.h"
+#include "DeviationPolicy.h"
+
+#include <vector>
+
+// Vectorizes products on the OdRxThreadPoolService.
+// The selection is dealt round robin into one partition per worker, neighbouring products in the file are often of
+// the same kind and cost, so the partitions get a similar share of the work. Every worker draws its partition
+// through an own ExGsSimpleDevice and view into an own TriangleCapture, the products of the captures are merged in
+// selection order afterwards, the output is the same for any number of workers.
+// The entities must be composed before, every device takes the deviations from deviationPolicy.
+class ParallelVectorizer
+{
+public:
+    // nThreads == 0 uses one worker per CPU reported by the thread pool
+    explicit ParallelVectorizer(unsigned int nThreads = 0);
+    ~ParallelVectorizer() = default;
+
+    void vectorize(OdIfcFile* pDatabase, const std::vector<OdDAIObjectId>& productIds, const DeviationPolicy& deviationPolicy, TriangleCapture& capture);
+
+private:
+    unsigned int mThreads;
+};
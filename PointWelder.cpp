@@ -0,0 +1,189 @@
+#include "PointWelder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const std::size_t kInitialSlotCount = 64;
+
+    // Smallest cell edge, keeps the cell coordinates of exact welding (tolerance 0) in range
+    const double kMinCellSize = 1e-9;
+
+    // Bound of the cell coordinates. Points further out share the border cells, they are still welded by distance.
+    // The neighbour cells (+-1) of a border cell stay in the int64 range
+    const double kMaxCellCoordinate = 4611686018427387904.0;   // 2^62
+
+    std::int64_t cellCoordinate(double coordinate, double cellSize)
+    {
+        const double cell = std::floor(coordinate / cellSize);
+        if (cell != cell)
+        {
+            return 0;
+        }
+        return static_cast<std::int64_t>(std::max(-kMaxCellCoordinate, std::min(cell, kMaxCellCoordinate)));
+    }
+}
+
+PointWelder::PointWelder(double tolerance)
+    : mTolerance(tolerance > 0.0 ? tolerance : 0.0)
+    , mCellSize(std::max(2.0 * mTolerance, kMinCellSize))
+{
+}
+
+std::size_t PointWelder::appendPointGetIdx(const OdGePoint3d& pt)
+{
+    std::size_t idx = find(pt);
+    if (idx != npos)
+    {
+        return idx;
+    }
+
+    // Keep the load factor at or below 1/2
+    if ((mPoints.size() + 1) * 2 > mSlots.size())
+    {
+        grow();
+    }
+
+    idx = mPoints.size();
+    const Cell cell = cellOf(pt);
+    mPoints.push_back(pt);
+    mPointCells.push_back(cell);
+    insertSlot(hashOf(cell), idx);
+
+    return idx;
+}
+
+std::size_t PointWelder::find(const OdGePoint3d& pt) const
+{
+    if (mSlots.empty())
+    {
+        return npos;
+    }
+
+    const Cell cell = cellOf(pt);
+
+    // A point within tolerance lies in a neighbour cell only along the axes where pt is within tolerance of the boundary
+    int lo[3];
+    int hi[3];
+    const std::int64_t cellCoords[3] = { cell.x, cell.y, cell.z };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const double offset = pt[axis] - static_cast<double>(cellCoords[axis]) * mCellSize;
+        lo[axis] = (offset <= mTolerance) ? -1 : 0;
+        hi[axis] = (offset >= mCellSize - mTolerance) ? 1 : 0;
+    }
+
+    std::size_t idx = findInCell(cell, pt);
+    for (int dx = lo[0]; idx == npos && dx <= hi[0]; ++dx)
+    {
+        for (int dy = lo[1]; idx == npos && dy <= hi[1]; ++dy)
+        {
+            for (int dz = lo[2]; idx == npos && dz <= hi[2]; ++dz)
+            {
+                if (dx != 0 || dy != 0 || dz != 0)
+                {
+                    idx = findInCell({ cell.x + dx, cell.y + dy, cell.z + dz }, pt);
+                }
+            }
+        }
+    }
+
+    return idx;
+}
+
+void PointWelder::reserve(std::size_t pointCount)
+{
+    mPoints.reserve(pointCount);
+    mPointCells.reserve(pointCount);
+
+    std::size_t slotCount = std::max(mSlots.size(), kInitialSlotCount);
+    while (slotCount < pointCount * 2)
+    {
+        slotCount *= 2;
+    }
+    if (slotCount != mSlots.size())
+    {
+        ScratchVector<Slot> slots(slotCount, Slot{ 0, npos }, mSlots.get_allocator());
+        mSlots.swap(slots);
+        for (std::size_t i = 0; i < mPoints.size(); ++i)
+        {
+            insertSlot(hashOf(mPointCells[i]), i);
+        }
+    }
+}
+
+void PointWelder::clear()
+{
+    mPoints.clear();
+    mPointCells.clear();
+    mSlots.clear();
+}
+
+PointWelder::Cell PointWelder::cellOf(const OdGePoint3d& pt) const
+{
+    return{ cellCoordinate(pt.x, mCellSize),
+            cellCoordinate(pt.y, mCellSize),
+            cellCoordinate(pt.z, mCellSize) };
+}
+
+std::uint64_t PointWelder::hashOf(const Cell& cell)
+{
+    // splitmix64 finalizer over the combined cell coordinates
+    std::uint64_t h = static_cast<std::uint64_t>(cell.x) * 0x9E3779B97F4A7C15ull
+        ^ static_cast<std::uint64_t>(cell.y) * 0xC2B2AE3D27D4EB4Full
+        ^ static_cast<std::uint64_t>(cell.z) * 0x165667B19E3779F9ull;
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+std::size_t PointWelder::findInCell(const Cell& cell, const OdGePoint3d& pt) const
+{
+    const std::uint64_t hash = hashOf(cell);
+    const std::size_t mask = mSlots.size() - 1;
+    for (std::size_t slotIdx = static_cast<std::size_t>(hash) & mask; mSlots[slotIdx].pointIdx != npos; slotIdx = (slotIdx + 1) & mask)
+    {
+        const Slot& slot = mSlots[slotIdx];
+        if (slot.hash != hash)
+        {
+            continue;
+        }
+
+        const Cell& slotCell = mPointCells[slot.pointIdx];
+        if (slotCell.x != cell.x || slotCell.y != cell.y || slotCell.z != cell.z)
+        {
+            continue;
+        }
+
+        const OdGePoint3d& candidate = mPoints[slot.pointIdx];
+        const double dx = candidate.x - pt.x;
+        const double dy = candidate.y - pt.y;
+        const double dz = candidate.z - pt.z;
+        if (dx * dx + dy * dy + dz * dz <= mTolerance * mTolerance)
+        {
+            return slot.pointIdx;
+        }
+    }
+
+    return npos;
+}
+
+void PointWelder::insertSlot(std::uint64_t hash, std::size_t pointIdx)
+{
+    const std::size_t mask = mSlots.size() - 1;
+    std::size_t slotIdx = static_cast<std::size_t>(hash) & mask;
+    while (mSlots[slotIdx].pointIdx != npos)
+    {
+        slotIdx = (slotIdx + 1) & mask;
+    }
+    mSlots[slotIdx] = { hash, pointIdx };
+}
+
+void PointWelder::grow()
+{
+    reserve(std::max<std::size_t>(mPoints.size() + 1, mSlots.size()));
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "Ge/GePoint3d.h"
+
+#include "ScratchArena.h"
+
+#include <cstdint>
+#include <vector>
+
+// Merges points closer than a tolerance and numbers them in insertion order.
+// Points are bucketed in a grid of cells of at least twice the tolerance, the cells are kept in a flat open addressing
+// table. A lookup probes the own cell, and the neighbour cells only along the axes where the point lies within the
+// tolerance of a cell boundary, so it usually touches a single cell.
+// The cells and the table are temporaries of the welder and come from the scratch arena when a welder is created in
+// an arena scope, the welded points are handed on and always come from the heap.
+class PointWelder
+{
+public:
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    explicit PointWelder(double tolerance = 1e-9);
+    ~PointWelder() = default;
+
+    // Returns the index of a point within tolerance of pt, appends pt if there is none
+    std::size_t appendPointGetIdx(const OdGePoint3d& pt);
+
+    // Returns the index of a point within tolerance of pt, or npos
+    std::size_t find(const OdGePoint3d& pt) const;
+
+    void reserve(std::size_t pointCount);
+    void clear();
+
+    std::size_t size() const { return mPoints.size(); }
+    double tolerance() const { return mTolerance; }
+
+    // Welded points, in index order
+    const std::vector<OdGePoint3d>& points() const { return mPoints; }
+
+private:
+    struct Cell
+    {
+        std::int64_t x;
+        std::int64_t y;
+        std::int64_t z;
+    };
+
+    struct Slot
+    {
+        std::uint64_t hash;
+        std::size_t pointIdx;
+    };
+
+    Cell cellOf(const OdGePoint3d& pt) const;
+    static std::uint64_t hashOf(const Cell& cell);
+
+    std::size_t findInCell(const Cell& cell, const OdGePoint3d& pt) const;
+    void insertSlot(std::uint64_t hash, std::size_t pointIdx);
+    void grow();
+
+    double mTolerance;
+    double mCellSize;
+    std::vector<OdGePoint3d> mPoints;
+    ScratchVector<Cell> mPointCells;
+    ScratchVector<Slot> mSlots;
+};
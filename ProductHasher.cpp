@@ -0,0 +1,169 @@
+#include "ProductHasher.h"
+#include "AttributeHelper.h"
+
+#include <cstring>
+
+namespace
+{
+    const std::uint64_t kFnvOffset = 14695981039346656037ull;
+    const std::uint64_t kFnvPrime = 1099511628211ull;
+
+    // Tags keep values of different kinds from hashing alike
+    enum ValueTag : std::uint8_t
+    {
+        kTagEmpty,
+        kTagNull,
+        kTagInstance,
+        kTagAggregate,
+        kTagReal,
+        kTagInteger,
+        kTagString,
+        kTagUnknown
+    };
+
+    // Attributes the conversion reads, per entity kind. Subtypes come before their supertypes, the kind index is
+    // hashed with the values. Profile definitions share one list, the attributes a profile type doesn't have are empty
+    const char* const kCartesianPoint[] = { "coordinates", nullptr };
+    const char* const kDirection[] = { "directionratios", nullptr };
+    const char* const kPlacement[] = { "location", "axis", "refdirection", nullptr };
+    const char* const kTransformationOperator[] = { "localorigin", "axis1", "axis2", "axis3", "scale", "scale2", "scale3", nullptr };
+    const char* const kMappedItem[] = { "mappingsource", "mappingtarget", nullptr };
+    const char* const kRepresentationMap[] = { "mappingorigin", "mappedrepresentation", nullptr };
+    const char* const kProductRepresentation[] = { "representations", nullptr };
+    const char* const kRepresentation[] = { "representationidentifier", "items", nullptr };
+    const char* const kShellBasedSurfaceModel[] = { "sbsmboundary", nullptr };
+    const char* const kConnectedFaceSet[] = { "cfsfaces", nullptr };
+    const char* const kFace[] = { "bounds", nullptr };
+    const char* const kFaceBound[] = { "bound", nullptr };
+    const char* const kPolyLoop[] = { "polygon", nullptr };
+    const char* const kExtrudedAreaSolid[] = { "sweptarea", "position", "extrudeddirection", "depth", nullptr };
+    const char* const kProfileDef[] = {
+        "position", "radius", "wallthickness", "xdim", "ydim", "roundingradius", "innerfilletradius", "outerfilletradius",
+        "overallwidth", "overalldepth", "webthickness", "flangethickness", "filletradius",
+        "bottomflangewidth", "bottomflangethickness", "bottomflangefilletradius", "topflangewidth", "topflangethickness", "topflangefilletradius",
+        "outercurve", "innercurves", nullptr };
+    const char* const kPolyline[] = { "points", nullptr };
+    const char* const kIndexedPolyCurve[] = { "points", "segments", nullptr };
+    const char* const kCartesianPointList[] = { "coordlist", nullptr };
+
+    // 0 and no attributes for the entities the conversion doesn't read
+    int entityKind(OdIfc::OdIfcInstance* inst, const char* const*& attributes)
+    {
+        static const char* const kNone[] = { nullptr };
+        attributes = kNone;
+        if (inst->isKindOf(OdIfc::kIfcCartesianPoint)) { attributes = kCartesianPoint; return 1; }
+        if (inst->isKindOf(OdIfc::kIfcDirection)) { attributes = kDirection; return 2; }
+        if (inst->isKindOf(OdIfc::kIfcPlacement)) { attributes = kPlacement; return 3; }
+        if (inst->isKindOf(OdIfc::kIfcCartesianTransformationOperator)) { attributes = kTransformationOperator; return 4; }
+        if (inst->isKindOf(OdIfc::kIfcMappedItem)) { attributes = kMappedItem; return 5; }
+        if (inst->isKindOf(OdIfc::kIfcRepresentationMap)) { attributes = kRepresentationMap; return 6; }
+        if (inst->isKindOf(OdIfc::kIfcProductRepresentation)) { attributes = kProductRepresentation; return 7; }
+        if (inst->isKindOf(OdIfc::kIfcRepresentation)) { attributes = kRepresentation; return 8; }
+        if (inst->isKindOf(OdIfc::kIfcShellBasedSurfaceModel)) { attributes = kShellBasedSurfaceModel; return 9; }
+        if (inst->isKindOf(OdIfc::kIfcConnectedFaceSet)) { attributes = kConnectedFaceSet; return 10; }
+        if (inst->isKindOf(OdIfc::kIfcFace)) { attributes = kFace; return 11; }
+        if (inst->isKindOf(OdIfc::kIfcFaceOuterBound)) { attributes = kFaceBound; return 19; }
+        if (inst->isKindOf(OdIfc::kIfcFaceBound)) { attributes = kFaceBound; return 12; }
+        if (inst->isKindOf(OdIfc::kIfcPolyLoop)) { attributes = kPolyLoop; return 13; }
+        if (inst->isKindOf(OdIfc::kIfcExtrudedAreaSolid)) { attributes = kExtrudedAreaSolid; return 14; }
+        if (inst->isKindOf(OdIfc::kIfcProfileDef)) { attributes = kProfileDef; return 15; }
+        if (inst->isKindOf(OdIfc::kIfcPolyline)) { attributes = kPolyline; return 16; }
+        if (inst->isKindOf(OdIfc::kIfcIndexedPolyCurve)) { attributes = kIndexedPolyCurve; return 17; }
+        if (inst->isKindOf(OdIfc::kIfcCartesianPointList2D)) { attributes = kCartesianPointList; return 18; }
+        return 0;
+    }
+}
+
+ProductHasher::ProductHasher(std::uint64_t seed)
+    : mSeed(seed)
+{
+}
+
+std::uint64_t ProductHasher::combine(std::uint64_t hash, const void* data, std::size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * kFnvPrime;
+    }
+    return hash;
+}
+
+std::uint64_t ProductHasher::hash(OdIfc::OdIfcInstance* product)
+{
+    OdRxValue representation = AttributeHelper::getAttr(product, "representation");
+    OdDAIObjectId representationId;
+    if (representation.isEmpty() || !(representation >> representationId) || representationId.isNull())
+    {
+        return 0;
+    }
+    const std::uint64_t hash = hashValue(combine(kFnvOffset, mSeed), representation);
+    return hash != 0 ? hash : 1;
+}
+
+std::uint64_t ProductHasher::hashInstance(OdIfc::OdIfcInstance* inst)
+{
+    const OdUInt64 handle = (OdUInt64)inst->id().getHandle();
+    auto it = mInstanceHashes.find(handle);
+    if (it != mInstanceHashes.end())
+    {
+        return it->second;
+    }
+
+    const char* const* attributes = nullptr;
+    std::uint64_t hash = combine(kFnvOffset, entityKind(inst, attributes));
+    for (; *attributes != nullptr; ++attributes)
+    {
+        hash = hashValue(hash, AttributeHelper::getAttr(inst, *attributes));
+    }
+    mInstanceHashes.emplace(handle, hash);
+    return hash;
+}
+
+std::uint64_t ProductHasher::hashValue(std::uint64_t hash, const OdRxValue& value)
+{
+    if (value.isEmpty())
+    {
+        return combine(hash, kTagEmpty);
+    }
+
+    OdDAIObjectId id;
+    if (value >> id)
+    {
+        OdIfc::OdIfcInstancePtr inst = id.openObject();
+        return inst.isNull() ? combine(hash, kTagNull) : combine(combine(hash, kTagInstance), hashInstance(inst));
+    }
+
+    OdDAI::Aggr* aggr = NULL;
+    if ((value >> aggr) && aggr != NULL)
+    {
+        if (aggr->isNil())
+        {
+            return combine(hash, kTagNull);
+        }
+        hash = combine(combine(hash, kTagAggregate), static_cast<std::uint64_t>(aggr->getMemberCount()));
+        OdDAI::IteratorPtr iterator = aggr->createIterator();
+        for (iterator->beginning(); iterator->next();)
+        {
+            hash = hashValue(hash, iterator->getCurrentMember());
+        }
+        return hash;
+    }
+
+    double real;
+    if (value >> real)
+    {
+        return combine(combine(hash, kTagReal), real);
+    }
+    int integer;
+    if (value >> integer)
+    {
+        return combine(combine(hash, kTagInteger), integer);
+    }
+    const char* str = nullptr;
+    if ((value >> str) && str != nullptr)
+    {
+        return combine(combine(hash, kTagString), str, std::strlen(str));
+    }
+    return combine(hash, kTagUnknown);
+}
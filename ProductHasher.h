@@ -0,0 +1,36 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+// Content hash of the representation of a product: the instances reachable through representation, items,
+// mappingsource, the swept areas and their profiles, down to the coordinates of the points. Only the values are
+// hashed, not the handles, so a product keeps its hash when the file is re-exported with other step ids.
+// The hash of every visited instance is kept by handle, shared representation maps and profiles are hashed once.
+class ProductHasher
+{
+public:
+    // seed covers everything else the conversion depends on (tolerances, levels of detail, output modes)
+    explicit ProductHasher(std::uint64_t seed = 0);
+
+    // 0 if the product has no representation
+    std::uint64_t hash(OdIfc::OdIfcInstance* product);
+
+    // FNV-1a, also used to build the seed
+    static std::uint64_t combine(std::uint64_t hash, const void* data, std::size_t size);
+
+    template<typename T>
+    static std::uint64_t combine(std::uint64_t hash, const T& value) { return combine(hash, &value, sizeof(T)); }
+
+private:
+    std::uint64_t hashInstance(OdIfc::OdIfcInstance* inst);
+    std::uint64_t hashValue(std::uint64_t hash, const OdRxValue& value);
+
+    std::uint64_t mSeed;
+    std::unordered_map<OdUInt64, std::uint64_t> mInstanceHashes;
+};
@@ -0,0 +1,98 @@
+#include "ProductTraversal.h"
+#include "AttributeHelper.h"
+#include "Profiler.h"
+
+ProductTraversal::ProductTraversal(OdIfcModel* pModel)
+    : mModel(pModel)
+{
+    OdDAI::SchemaPtr schema = pModel->underlyingSchema();
+    const OdDAI::Set<OdDAI::Entity*>& entities = schema->entities();
+
+    OdDAI::Entity* pProductEntity = nullptr;
+    std::vector<OdDAI::Entity*> instantiableEntities;
+    for (OdDAI::ConstIteratorPtr it = entities.createConstIterator(); it->next();)
+    {
+        OdDAI::Entity* pEntity;
+        it->getCurrentMember() >> pEntity;
+        if (pEntity->name() == "ifcproduct")
+        {
+            pProductEntity = pEntity;
+        }
+        if (pEntity->instantiable())
+        {
+            instantiableEntities.push_back(pEntity);
+        }
+    }
+
+    if (pProductEntity == nullptr)
+    {
+        return;
+    }
+
+    for (OdDAI::Entity* pEntity : instantiableEntities)
+    {
+        if (isSubtypeOf(pEntity, pProductEntity))
+        {
+            mProductEntities.push_back(pEntity);
+        }
+    }
+}
+
+std::vector<OdDAIObjectId> ProductTraversal::collectProducts() const
+{
+    BREP_PROFILE_SCOPE("collectProducts");
+    std::vector<OdDAIObjectId> ret;
+    for (OdDAI::Entity* pEntity : mProductEntities)
+    {
+        OdDAI::Set<OdDAIObjectId>* extent = mModel->getEntityExtent(pEntity->name());
+        if (extent == nullptr || extent->isNil())
+        {
+            continue;
+        }
+
+        for (OdDAI::ConstIteratorPtr it = extent->createConstIterator(); it->next();)
+        {
+            OdDAIObjectId id;
+            it->getCurrentMember() >> id;
+            Profiler::count(ProfileCounter::InstancesVisited);
+
+            OdIfc::OdIfcInstancePtr pInst = id.openObject();
+            if (pInst.isNull())
+            {
+                continue;
+            }
+
+            OdDAIObjectId representationId;
+            OdRxValue val = AttributeHelper::getAttr(pInst, "representation");
+            if (val.isEmpty() || !(val >> representationId) || OdDAI::Utils::isUnset(representationId))
+            {
+                continue;
+            }
+
+            ret.push_back(id);
+        }
+    }
+
+    return ret;
+}
+
+bool ProductTraversal::isSubtypeOf(OdDAI::Entity* pEntity, OdDAI::Entity* pSupertype)
+{
+    if (pEntity == pSupertype)
+    {
+        return true;
+    }
+
+    const OdDAI::List<OdDAI::Entity*>& superEntities = pEntity->supertypes();
+    for (OdDAI::ConstIteratorPtr it_super = superEntities.createConstIterator(); it_super->next();)
+    {
+        OdDAI::Entity* pSuperEntity;
+        it_super->getCurrentMember() >> pSuperEntity;
+        if (isSubtypeOf(pSuperEntity, pSupertype))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include <vector>
+
+// Enumerates the products of a model through the instance extents of the instantiable IfcProduct subtypes
+// (IfcWall, IfcBuildingElementProxy, IfcFlowSegment, ...), so that points, directions, property sets and the
+// other non-product instances are never opened.
+class ProductTraversal
+{
+public:
+    explicit ProductTraversal(OdIfcModel* pModel);
+    ~ProductTraversal() = default;
+
+    // Instantiable IfcProduct subtypes of the model schema, resolved once at construction
+    const std::vector<OdDAI::Entity*>& productEntities() const { return mProductEntities; }
+
+    // Ids of the products that have a representation, in extent order of productEntities()
+    std::vector<OdDAIObjectId> collectProducts() const;
+
+private:
+    static bool isSubtypeOf(OdDAI::Entity* pEntity, OdDAI::Entity* pSupertype);
+
+    OdIfcModel* mModel;
+    std::vector<OdDAI::Entity*> mProductEntities;
+};
@@ -0,0 +1,338 @@
+#include "ProfileCache.h"
+#include "AttributeHelper.h"
+#include "Log.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Bulge of a quarter circle arc, tan(90deg / 4)
+    const double kQuarterBulge = 0.41421356237309503;
+
+    // IfcAxis2Placement2D of a parameterized profile, the axes default to the global ones
+    struct Placement2d
+    {
+        OdGePoint2d origin;
+        OdGeVector2d xAxis = OdGeVector2d::kXAxis;
+
+        OdGePoint2d apply(const OdGePoint2d& pt) const
+        {
+            return origin + xAxis * pt.x + xAxis.perpVector() * pt.y;
+        }
+    };
+
+    Placement2d getPlacement(OdIfc::OdIfcInstance* profileDef)
+    {
+        Placement2d placement;
+        OdIfc::OdIfcInstancePtr position = AttributeHelper::getAttributeAsInstance(profileDef, "position");
+        if (position.isNull())
+        {
+            return placement;
+        }
+        OdGeVector2d location = AttributeHelper::getVector<OdGeVector2d>(position, "location", "coordinates");
+        OdGeVector2d refdirection = AttributeHelper::getVector<OdGeVector2d>(position, "refdirection", "directionratios");
+        placement.origin = location.asPoint();
+        if (!refdirection.isZeroLength())
+        {
+            placement.xAxis = refdirection.normal();
+        }
+        return placement;
+    }
+
+    // Closed contour in profile coordinates, bulges[i] is the arc from points[i] to the next point (0 for a line)
+    struct Outline
+    {
+        std::vector<OdGePoint2d> points;
+        std::vector<double> bulges;
+
+        // Repeated points, like the closing point of an IfcPolyline, are dropped
+        void add(const OdGePoint2d& pt, double bulge = 0.0)
+        {
+            if (!points.empty() && points.back().isEqualTo(pt))
+            {
+                bulges.back() = bulge;
+                return;
+            }
+            points.push_back(pt);
+            bulges.push_back(bulge);
+        }
+
+        void close()
+        {
+            if (points.size() > 1 && points.back().isEqualTo(points.front()))
+            {
+                points.pop_back();
+                bulges.pop_back();
+            }
+        }
+
+        double radius() const
+        {
+            if (points.empty())
+            {
+                return 0.0;
+            }
+            OdGePoint2d minPt = points.front();
+            OdGePoint2d maxPt = points.front();
+            for (const OdGePoint2d& pt : points)
+            {
+                minPt.set(std::min(minPt.x, pt.x), std::min(minPt.y, pt.y));
+                maxPt.set(std::max(maxPt.x, pt.x), std::max(maxPt.y, pt.y));
+            }
+            return 0.5 * std::max(maxPt.x - minPt.x, maxPt.y - minPt.y);
+        }
+    };
+
+    Outline circle(double radius)
+    {
+        Outline outline;
+        outline.add(OdGePoint2d(-radius, 0.0), 1.0);
+        outline.add(OdGePoint2d(radius, 0.0), 1.0);
+        return outline;
+    }
+
+    // Rectangle centered on the origin, counterclockwise, with corner arcs of the fillet radius
+    Outline rectangle(double halfX, double halfY, double fillet)
+    {
+        fillet = std::max(0.0, std::min(fillet, std::min(halfX, halfY)));
+        const double bulge = fillet > 0.0 ? kQuarterBulge : 0.0;
+        Outline outline;
+        outline.add(OdGePoint2d(-halfX + fillet, -halfY));
+        outline.add(OdGePoint2d(halfX - fillet, -halfY), bulge);
+        outline.add(OdGePoint2d(halfX, -halfY + fillet));
+        outline.add(OdGePoint2d(halfX, halfY - fillet), bulge);
+        outline.add(OdGePoint2d(halfX - fillet, halfY));
+        outline.add(OdGePoint2d(-halfX + fillet, halfY), bulge);
+        outline.add(OdGePoint2d(-halfX, halfY - fillet));
+        outline.add(OdGePoint2d(-halfX, -halfY + fillet), bulge);
+        outline.close();
+        return outline;
+    }
+
+    // I-shape centered on the origin, the fillets between web and flanges are not modeled
+    Outline iShape(double width, double depth, double webThickness, double flangeThickness)
+    {
+        const double halfW = 0.5 * width;
+        const double halfD = 0.5 * depth;
+        const double halfWeb = 0.5 * webThickness;
+        Outline outline;
+        outline.add(OdGePoint2d(-halfW, -halfD));
+        outline.add(OdGePoint2d(halfW, -halfD));
+        outline.add(OdGePoint2d(halfW, -halfD + flangeThickness));
+        outline.add(OdGePoint2d(halfWeb, -halfD + flangeThickness));
+        outline.add(OdGePoint2d(halfWeb, halfD - flangeThickness));
+        outline.add(OdGePoint2d(halfW, halfD - flangeThickness));
+        outline.add(OdGePoint2d(halfW, halfD));
+        outline.add(OdGePoint2d(-halfW, halfD));
+        outline.add(OdGePoint2d(-halfW, halfD - flangeThickness));
+        outline.add(OdGePoint2d(-halfWeb, halfD - flangeThickness));
+        outline.add(OdGePoint2d(-halfWeb, -halfD + flangeThickness));
+        outline.add(OdGePoint2d(-halfW, -halfD + flangeThickness));
+        return outline;
+    }
+
+    // IfcPolyline, or IfcIndexedPolyCurve made of straight segments through all its points
+    bool getCurveOutline(OdIfc::OdIfcInstance* curve, Outline& outline)
+    {
+        std::vector<OdGePoint2d> points;
+        if (curve->isKindOf(OdIfc::kIfcPolyline))
+        {
+            AttributeHelper::getPoints2d(curve, "points", points);
+        }
+        else if (curve->isKindOf(OdIfc::kIfcIndexedPolyCurve))
+        {
+            OdDAI::Aggr* segments = NULL;
+            if ((AttributeHelper::getAttr(curve, "segments") >> segments) && segments != NULL && !segments->isNil() && segments->getMemberCount() > 0)
+            {
+                return false;
+            }
+            OdIfc::OdIfcInstancePtr pointList = AttributeHelper::getAttributeAsInstance(curve, "points");
+            if (pointList.isNull() || !pointList->isKindOf(OdIfc::kIfcCartesianPointList2D))
+            {
+                return false;
+            }
+            AttributeHelper::getPointList2d(pointList, points);
+        }
+        else
+        {
+            return false;
+        }
+
+        for (const OdGePoint2d& pt : points)
+        {
+            outline.add(pt);
+        }
+        outline.close();
+        return outline.points.size() > 2;
+    }
+
+    void appendContour(FacetModeler::Profile2D& profile, const Outline& outline, const Placement2d& placement, bool outer)
+    {
+        profile.resize(profile.size() + 1);
+        FacetModeler::Contour2D& contour = profile[profile.size() - 1];
+        for (std::size_t i = 0; i < outline.points.size(); ++i)
+        {
+            contour.appendVertex(placement.apply(outline.points[i]), outline.bulges[i]);
+            if (outline.bulges[i] != 0.0)
+            {
+                contour.setOrientationAt((OdUInt32)i, FacetModeler::efoFront);
+            }
+        }
+        contour.setClosed();
+        contour.makeCCW(outer);               // outer contours counterclockwise, voids clockwise
+    }
+}
+
+const ProfileCache::Entry* ProfileCache::get(OdIfc::OdIfcInstance* profileDef)
+{
+    if (profileDef == nullptr)
+    {
+        return nullptr;
+    }
+    const OdUInt64 handle = (OdUInt64)profileDef->id().getHandle();
+    auto it = mProfiles.find(handle);
+    if (it == mProfiles.end())
+    {
+        BREP_PROFILE_SCOPE("buildProfile");
+        Entry entry;
+        entry.supported = build(profileDef, entry);
+        Profiler::count(ProfileCounter::ProfilesBuilt);
+        it = mProfiles.emplace(handle, std::move(entry)).first;
+    }
+    return it->second.supported ? &it->second : nullptr;
+}
+
+void ProfileCache::appendCircle(FacetModeler::Profile2D& profile, const OdGePoint2d& center, const OdGeVector2d& direction, double radius)
+{
+    Placement2d placement;
+    placement.origin = center;
+    if (!direction.isZeroLength())
+    {
+        placement.xAxis = direction.normal();
+    }
+    appendContour(profile, circle(radius), placement, true);
+}
+
+bool ProfileCache::build(OdIfc::OdIfcInstance* profileDef, Entry& entry)
+{
+    Outline outer;
+    std::vector<Outline> voids;
+    Placement2d placement;
+
+    // Subtypes are tested before their supertypes
+    if (profileDef->isKindOf(OdIfc::kIfcCircleHollowProfileDef))
+    {
+        const double radius = AttributeHelper::getDouble(profileDef, "radius");
+        const double wallThickness = AttributeHelper::getOptionalDouble(profileDef, "wallthickness", 0.0);
+        outer = circle(radius);
+        if (wallThickness > 0.0 && wallThickness < radius)
+        {
+            voids.push_back(circle(radius - wallThickness));
+        }
+        placement = getPlacement(profileDef);
+    }
+    else if (profileDef->isKindOf(OdIfc::kIfcCircleProfileDef))
+    {
+        outer = circle(AttributeHelper::getDouble(profileDef, "radius"));
+        placement = getPlacement(profileDef);
+    }
+    else if (profileDef->isKindOf(OdIfc::kIfcRectangleHollowProfileDef))
+    {
+        const double halfX = 0.5 * AttributeHelper::getDouble(profileDef, "xdim");
+        const double halfY = 0.5 * AttributeHelper::getDouble(profileDef, "ydim");
+        const double wallThickness = AttributeHelper::getOptionalDouble(profileDef, "wallthickness", 0.0);
+        outer = rectangle(halfX, halfY, AttributeHelper::getOptionalDouble(profileDef, "outerfilletradius", 0.0));
+        if (wallThickness > 0.0 && wallThickness < std::min(halfX, halfY))
+        {
+            voids.push_back(rectangle(halfX - wallThickness, halfY - wallThickness, AttributeHelper::getOptionalDouble(profileDef, "innerfilletradius", 0.0)));
+        }
+        placement = getPlacement(profileDef);
+    }
+    else if (profileDef->isKindOf(OdIfc::kIfcRoundedRectangleProfileDef))
+    {
+        outer = rectangle(0.5 * AttributeHelper::getDouble(profileDef, "xdim"), 0.5 * AttributeHelper::getDouble(profileDef, "ydim"),
+            AttributeHelper::getOptionalDouble(profileDef, "roundingradius", 0.0));
+        placement = getPlacement(profileDef);
+    }
+    else if (profileDef->isKindOf(OdIfc::kIfcRectangleProfileDef))
+    {
+        outer = rectangle(0.5 * AttributeHelper::getDouble(profileDef, "xdim"), 0.5 * AttributeHelper::getDouble(profileDef, "ydim"), 0.0);
+        placement = getPlacement(profileDef);
+    }
+    else if (profileDef->isKindOf(OdIfc::kIfcAsymmetricIShapeProfileDef))
+    {
+        // IfcIShapeProfileDef subtype in IFC2x3, its flanges differ
+        return false;
+    }
+    else if (profileDef->isKindOf(OdIfc::kIfcIShapeProfileDef))
+    {
+        outer = iShape(
+            AttributeHelper::getDouble(profileDef, "overallwidth"),
+            AttributeHelper::getDouble(profileDef, "overalldepth"),
+            AttributeHelper::getDouble(profileDef, "webthickness"),
+            AttributeHelper::getDouble(profileDef, "flangethickness"));
+        placement = getPlacement(profileDef);
+    }
+    else if (profileDef->isKindOf(OdIfc::kIfcArbitraryClosedProfileDef))
+    {
+        OdIfc::OdIfcInstancePtr outerCurve = AttributeHelper::getAttributeAsInstance(profileDef, "outercurve");
+        if (outerCurve.isNull() || !getCurveOutline(outerCurve, outer))
+        {
+            return false;
+        }
+        if (profileDef->isKindOf(OdIfc::kIfcArbitraryProfileDefWithVoids))
+        {
+            for (const auto& innerCurve : AttributeHelper::getAttributeAsInstanceRange(profileDef, "innercurves"))
+            {
+                Outline inner;
+                if (innerCurve.isNull() || !getCurveOutline(innerCurve, inner))
+                {
+                    return false;
+                }
+                voids.push_back(std::move(inner));
+            }
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    if (outer.points.size() < 2)
+    {
+        return false;
+    }
+
+    appendContour(entry.profile, outer, placement, true);
+    for (const Outline& inner : voids)
+    {
+        appendContour(entry.profile, inner, placement, false);
+    }
+    entry.radius = outer.radius();
+
+    if (voids.empty() && outer.points.size() == 2 && outer.bulges[0] == 1.0 && outer.bulges[1] == 1.0)
+    {
+        entry.shape = Shape::Circle;
+        entry.center = placement.apply(outer.points[0] + (outer.points[1] - outer.points[0]) * 0.5);
+    }
+    else if (voids.empty() && outer.points.size() > 2 && std::all_of(outer.bulges.begin(), outer.bulges.end(), [](double bulge) { return bulge == 0.0; }))
+    {
+        double doubleArea = 0.0;
+        for (std::size_t i = 0; i < outer.points.size(); ++i)
+        {
+            const OdGePoint2d& pt = outer.points[i];
+            const OdGePoint2d& next = outer.points[(i + 1) % outer.points.size()];
+            doubleArea += pt.x * next.y - next.x * pt.y;
+            entry.polygon.push_back(placement.apply(pt));
+        }
+        if (doubleArea < 0.0)
+        {
+            std::reverse(entry.polygon.begin(), entry.polygon.end());
+        }
+        entry.shape = Shape::Polygon;
+    }
+    BREP_LOG(Debug, "profile #" << (OdUInt64)profileDef->id().getHandle() << ": " << entry.profile.size() << " contours, radius " << entry.radius);
+    return true;
+}
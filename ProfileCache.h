@@ -0,0 +1,57 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "IfcExamplesCommon.h"
+#include "IfcCore.h"
+
+#include "FMProfile3D.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Base profiles of IfcExtrudedAreaSolids, built once per IfcProfileDef.
+// Arcs are kept as bulges, so a profile is exact and doesn't depend on the deviation: every extrusion of it, at any
+// level of detail, reuses the same Profile2D and only passes its own placement and deviation to Body::extrusion.
+//
+// Supported: IfcCircleProfileDef, IfcCircleHollowProfileDef, IfcRectangleProfileDef, IfcRoundedRectangleProfileDef,
+// IfcRectangleHollowProfileDef, IfcIShapeProfileDef (without fillets) and IfcArbitraryClosedProfileDef /
+// IfcArbitraryProfileDefWithVoids bounded by IfcPolylines or IfcIndexedPolyCurves without segments.
+class ProfileCache
+{
+public:
+    // Profiles simple enough to be written as analytic primitives
+    enum class Shape
+    {
+        Circle,         // single circle of radius around center
+        Polygon,        // single contour of straight segments
+        Other
+    };
+
+    struct Entry
+    {
+        FacetModeler::Profile2D profile;    // in the coordinates of the extrusion position
+        double radius = 0.0;                // half the larger extent of the outer contour, sizes the deviation
+        bool supported = false;
+        Shape shape = Shape::Other;
+        OdGePoint2d center;                 // circles
+        std::vector<OdGePoint2d> polygon;   // polygons, counterclockwise
+    };
+
+    ProfileCache() = default;
+    ~ProfileCache() = default;
+
+    // Profile of an IfcProfileDef, built on first use. nullptr for unsupported profile types
+    const Entry* get(OdIfc::OdIfcInstance* profileDef);
+
+    std::size_t size() const { return mProfiles.size(); }
+    void clear() { mProfiles.clear(); }
+
+    // Closed contour of a circle of radius around center, starting along direction
+    static void appendCircle(FacetModeler::Profile2D& profile, const OdGePoint2d& center, const OdGeVector2d& direction, double radius);
+
+private:
+    static bool build(OdIfc::OdIfcInstance* profileDef, Entry& entry);
+
+    std::unordered_map<OdUInt64, Entry> mProfiles;
+};
@@ -0,0 +1,217 @@
+#include "Profiler.h"
+#include "BrepJsonWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const char* const kCounterNames[] = {
+        "instancesVisited",
+        "productsConverted",
+        "geometriesConverted",
+        "pointsWelded",
+        "verticesEmitted",
+        "edgesEmitted",
+        "facesEmitted",
+        "bytesWritten",
+        "triangles",
+        "instancedTriangles",
+        "profilesBuilt",
+        "scratchAllocations",
+        "scratchHeapAllocations",
+        "fragmentCacheHits",
+        "fragmentCacheMisses"
+    };
+    static_assert(sizeof(kCounterNames) / sizeof(kCounterNames[0]) == static_cast<int>(ProfileCounter::Count), "kCounterNames must name every ProfileCounter");
+
+    struct ScopeStats
+    {
+        std::uint64_t calls = 0;
+        std::uint64_t totalNs = 0;
+        std::uint64_t maxNs = 0;
+    };
+
+    struct Span
+    {
+        const char* name;
+        std::uint64_t start;
+        std::uint64_t end;
+    };
+
+    // Only the owning thread writes, the report is taken after the workers are done
+    struct ThreadProfile
+    {
+        unsigned int threadIdx = 0;
+        std::unordered_map<const char*, ScopeStats> scopes;
+        std::vector<Span> spans;
+    };
+
+    struct ProfileRegistry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadProfile>> threads;
+        std::vector<std::pair<std::string, std::uint64_t>> extraCounters;
+        std::uint64_t startNs = 0;
+        bool recordSpans = false;
+
+        static ProfileRegistry& instance()
+        {
+            static ProfileRegistry registry;
+            return registry;
+        }
+    };
+
+    ThreadProfile& threadProfile()
+    {
+        thread_local std::shared_ptr<ThreadProfile> profile;
+        if (!profile)
+        {
+            profile = std::make_shared<ThreadProfile>();
+            ProfileRegistry& registry = ProfileRegistry::instance();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            profile->threadIdx = static_cast<unsigned int>(registry.threads.size());
+            registry.threads.push_back(profile);
+        }
+        return *profile;
+    }
+
+    // Scope statistics of all threads by name, the per thread maps are keyed by the literal pointers
+    std::map<std::string, ScopeStats> mergedScopes(const std::vector<std::shared_ptr<ThreadProfile>>& threads)
+    {
+        std::map<std::string, ScopeStats> ret;
+        for (const auto& thread : threads)
+        {
+            for (const auto& scope : thread->scopes)
+            {
+                ScopeStats& stats = ret[scope.first];
+                stats.calls += scope.second.calls;
+                stats.totalNs += scope.second.totalNs;
+                stats.maxNs = std::max(stats.maxNs, scope.second.maxNs);
+            }
+        }
+        return ret;
+    }
+}
+
+std::atomic<bool> Profiler::sEnabled(false);
+std::atomic<std::uint64_t> Profiler::sCounters[static_cast<int>(ProfileCounter::Count)];
+
+void Profiler::enable(bool recordSpans)
+{
+    ProfileRegistry& registry = ProfileRegistry::instance();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.startNs = now();
+        registry.recordSpans = recordSpans;
+    }
+    sEnabled.store(true);
+}
+
+void Profiler::setExtraCounter(const char* name, std::uint64_t value)
+{
+    ProfileRegistry& registry = ProfileRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.extraCounters.emplace_back(name, value);
+}
+
+void Profiler::record(const char* name, std::uint64_t start, std::uint64_t end)
+{
+    ThreadProfile& profile = threadProfile();
+    ScopeStats& stats = profile.scopes[name];
+    const std::uint64_t duration = end - start;
+    ++stats.calls;
+    stats.totalNs += duration;
+    stats.maxNs = std::max(stats.maxNs, duration);
+
+    if (ProfileRegistry::instance().recordSpans)
+    {
+        profile.spans.push_back({ name, start, end });
+    }
+}
+
+bool Profiler::writeReport(const std::string& filename)
+{
+    std::ofstream reportStream(filename.c_str(), std::ofstream::out);
+    if (!reportStream)
+    {
+        return false;
+    }
+
+    ProfileRegistry& registry = ProfileRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    BrepJsonWriter writer(reportStream, true);
+    writer.beginObject();
+    writer.value("threads", static_cast<std::uint64_t>(registry.threads.size()));
+
+    writer.beginArray("scopes");
+    for (const auto& scope : mergedScopes(registry.threads))
+    {
+        writer.beginObject();
+        writer.value("name", scope.first.c_str());
+        writer.value("calls", scope.second.calls);
+        writer.value("totalMs", scope.second.totalNs * 1e-6);
+        writer.value("maxMs", scope.second.maxNs * 1e-6);
+        writer.endObject();
+    }
+    writer.endArray();
+
+    writer.beginObject("counters");
+    for (int i = 0; i < static_cast<int>(ProfileCounter::Count); ++i)
+    {
+        writer.value(kCounterNames[i], sCounters[i].load());
+    }
+    for (const auto& counter : registry.extraCounters)
+    {
+        writer.value(counter.first.c_str(), counter.second);
+    }
+    writer.endObject();
+
+    writer.endObject();
+    writer.flush();
+    return static_cast<bool>(reportStream);
+}
+
+bool Profiler::writeTrace(const std::string& filename)
+{
+    std::ofstream traceStream(filename.c_str(), std::ofstream::out);
+    if (!traceStream)
+    {
+        return false;
+    }
+
+    ProfileRegistry& registry = ProfileRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // Complete events ("ph":"X") with microsecond timestamps relative to enable()
+    BrepJsonWriter writer(traceStream);
+    writer.beginObject();
+    writer.beginArray("traceEvents");
+    for (const auto& thread : registry.threads)
+    {
+        for (const Span& span : thread->spans)
+        {
+            writer.beginObject();
+            writer.value("name", span.name);
+            writer.value("ph", "X");
+            writer.value("ts", (span.start - std::min(span.start, registry.startNs)) * 1e-3);
+            writer.value("dur", (span.end - span.start) * 1e-3);
+            writer.value("pid", static_cast<std::uint64_t>(1));
+            writer.value("tid", static_cast<std::uint64_t>(thread->threadIdx));
+            writer.endObject();
+        }
+    }
+    writer.endArray();
+    writer.value("displayTimeUnit", "ms");
+    writer.endObject();
+    writer.flush();
+    return static_cast<bool>(traceStream);
+}
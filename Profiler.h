@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Per stage timing and counters of a conversion run.
+//
+//   BREP_PROFILE_SCOPE("getSurfaceModel");
+//   Profiler::count(ProfileCounter::FacesEmitted, faceCount);
+//
+// Scopes are aggregated per name (calls, total and max time) on the thread that runs them, counters are global.
+// With tracing enabled every scope is also kept as a span for a Chrome trace event file (chrome://tracing, Perfetto).
+// Everything is a single flag test while the profiler is disabled.
+enum class ProfileCounter
+{
+    InstancesVisited,
+    ProductsConverted,
+    GeometriesConverted,
+    PointsWelded,
+    VerticesEmitted,
+    EdgesEmitted,
+    FacesEmitted,
+    BytesWritten,
+    Triangles,              // level 0 geometries, fan triangulated
+    InstancedTriangles,     // level 0 geometries times their instances
+    ProfilesBuilt,          // distinct IfcProfileDefs, every further extrusion reuses them
+    ScratchAllocations,     // conversion temporaries served by the per thread arena
+    ScratchHeapAllocations, // conversion temporaries and arena blocks allocated on the heap
+    FragmentCacheHits,      // products spliced from the fragment cache
+    FragmentCacheMisses,    // products converted with the fragment cache enabled
+    Count
+};
+
+class Profiler
+{
+public:
+    // Names are expected to be string literals, they are kept by pointer
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name)
+            : mName(Profiler::isEnabled() ? name : nullptr)
+        {
+            if (mName != nullptr)
+            {
+                mStart = Profiler::now();
+            }
+        }
+
+        ~Scope()
+        {
+            if (mName != nullptr)
+            {
+                Profiler::record(mName, mStart, Profiler::now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* mName;
+        std::uint64_t mStart = 0;
+    };
+
+    static void enable(bool recordSpans);
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    static void count(ProfileCounter counter, std::uint64_t n = 1)
+    {
+        if (isEnabled())
+        {
+            sCounters[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    // Values owned by other components (e.g. the attribute cache), reported next to the counters
+    static void setExtraCounter(const char* name, std::uint64_t value);
+
+    // JSON report of the scopes and counters, returns false if the file can't be written
+    static bool writeReport(const std::string& filename);
+
+    // Chrome trace event file with one complete event per span, requires enable(true)
+    static bool writeTrace(const std::string& filename);
+
+private:
+    // Steady clock in nanoseconds
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static void record(const char* name, std::uint64_t start, std::uint64_t end);
+
+    static std::atomic<bool> sEnabled;
+    static std::atomic<std::uint64_t> sCounters[static_cast<int>(ProfileCounter::Count)];
+};
+
+#define BREP_PROFILE_CONCAT_(a, b) a##b
+#define BREP_PROFILE_CONCAT(a, b) BREP_PROFILE_CONCAT_(a, b)
+#define BREP_PROFILE_SCOPE(name) Profiler::Scope BREP_PROFILE_CONCAT(brepProfileScope, __LINE__)(name)
@@ -0,0 +1,70 @@
+#include "ScratchArena.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Large enough for the faces and bounds of a typical surface model, larger requests get a block of their own
+    const std::size_t kBlockSize = 64 * 1024;
+}
+
+std::atomic<bool> ScratchArena::sEnabled(true);
+
+ScratchArena::Scope::Scope(ScratchArena& arena)
+    : mArena(ScratchArena::isEnabled() ? &arena : nullptr)
+{
+    if (mArena != nullptr)
+    {
+        mBlockIdx = mArena->mBlockIdx;
+        mOffset = mArena->mOffset;
+        ++mArena->mScopeDepth;
+    }
+}
+
+ScratchArena::Scope::~Scope()
+{
+    if (mArena != nullptr)
+    {
+        mArena->mBlockIdx = mBlockIdx;
+        mArena->mOffset = mOffset;
+        --mArena->mScopeDepth;
+    }
+}
+
+ScratchArena& ScratchArena::threadArena()
+{
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+void* ScratchArena::allocate(std::size_t size, std::size_t alignment)
+{
+    size = std::max<std::size_t>(size, 1);
+    for (;;)
+    {
+        if (mBlockIdx < mBlocks.size())
+        {
+            Block& block = mBlocks[mBlockIdx];
+            const std::size_t offset = (mOffset + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= block.size)
+            {
+                mOffset = offset + size;
+                return block.data.get() + offset;
+            }
+            if (mBlockIdx + 1 < mBlocks.size() && size + alignment <= mBlocks[mBlockIdx + 1].size)
+            {
+                ++mBlockIdx;
+                mOffset = 0;
+                continue;
+            }
+        }
+
+        // The blocks behind the current one are kept, a new block goes right after it
+        const std::size_t blockSize = std::max(kBlockSize, size + alignment);
+        Profiler::count(ProfileCounter::ScratchHeapAllocations);
+        const std::size_t blockIdx = mBlocks.empty() ? 0 : mBlockIdx + 1;
+        mBlocks.insert(mBlocks.begin() + blockIdx, Block{ std::unique_ptr<char[]>(new char[blockSize]), blockSize });
+        mBlockIdx = blockIdx;
+        mOffset = 0;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Profiler.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Monotonic arena for the temporaries of a product conversion.
+//
+//   ScratchArena::Scope scratchScope(ScratchArena::threadArena());
+//   ScratchVector<OdIfc::OdIfcInstancePtr> faces;
+//
+// Every thread owns an arena, so the parallel conversion doesn't share it. Allocations bump a pointer through a list
+// of blocks and are never freed one by one, leaving the outermost scope rewinds the arena and keeps its blocks for
+// the next product. Scratch containers must not outlive the scope they were created in. Outside of a scope (or with
+// the arena disabled) they allocate from the heap like std::vector.
+class ScratchArena
+{
+public:
+    class Scope
+    {
+    public:
+        explicit Scope(ScratchArena& arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ScratchArena* mArena;
+        std::size_t mBlockIdx = 0;
+        std::size_t mOffset = 0;
+    };
+
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    static ScratchArena& threadArena();
+
+    // Disabled arenas hand every allocation to the heap, for comparing the allocation counts
+    static void setEnabled(bool enabled) { sEnabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    bool isActive() const { return mScopeDepth > 0; }
+
+    void* allocate(std::size_t size, std::size_t alignment);
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    std::vector<Block> mBlocks;
+    std::size_t mBlockIdx = 0;
+    std::size_t mOffset = 0;
+    int mScopeDepth = 0;
+
+    static std::atomic<bool> sEnabled;
+};
+
+// Allocates from the arena of the thread if it was active when the allocator was created, from the heap otherwise.
+// Deallocation is a no-op for arena memory, the scope releases it at once.
+template<typename T>
+class ScratchAllocator
+{
+public:
+    using value_type = T;
+
+    ScratchAllocator()
+        : mArena(ScratchArena::threadArena().isActive() ? &ScratchArena::threadArena() : nullptr)
+    {
+    }
+
+    template<typename U>
+    ScratchAllocator(const ScratchAllocator<U>& other)
+        : mArena(other.arena())
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (mArena != nullptr)
+        {
+            Profiler::count(ProfileCounter::ScratchAllocations);
+            return static_cast<T*>(mArena->allocate(n * sizeof(T), alignof(T)));
+        }
+        Profiler::count(ProfileCounter::ScratchHeapAllocations);
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t /*n*/)
+    {
+        if (mArena == nullptr)
+        {
+            ::operator delete(p);
+        }
+    }
+
+    ScratchArena* arena() const { return mArena; }
+
+    template<typename U>
+    bool operator==(const ScratchAllocator<U>& rhs) const { return mArena == rhs.arena(); }
+    template<typename U>
+    bool operator!=(const ScratchAllocator<U>& rhs) const { return mArena != rhs.arena(); }
+
+private:
+    ScratchArena* mArena;
+};
+
+template<typename T>
+using ScratchVector = std::vector<T, ScratchAllocator<T>>;
@@ -0,0 +1,165 @@
+#include "SyntheticIfcGenerator.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const char kGlobalIdChars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_$";
+
+    // Deterministic, unique 22 character IfcGloballyUniqueId for a sequence number
+    std::string globalId(std::size_t seq)
+    {
+        std::string ret(22, '0');
+        unsigned long long value = 0x9E3779B97F4A7C15ull * (seq + 1);
+        for (int i = 21; i > 10; --i, value >>= 6)
+        {
+            ret[i] = kGlobalIdChars[value & 63];
+        }
+        value = seq;
+        for (int i = 10; i > 0; --i, value >>= 6)
+        {
+            ret[i] = kGlobalIdChars[value & 63];
+        }
+        return ret;
+    }
+
+    class StepWriter
+    {
+    public:
+        explicit StepWriter(std::FILE* file) : mFile(file) {}
+
+        // Writes "#id=<entity>;" and returns the id
+        template<typename... Args>
+        std::size_t add(const char* format, Args... args)
+        {
+            const std::size_t id = ++mLastId;
+            std::fprintf(mFile, "#%zu=", id);
+            std::fprintf(mFile, format, args...);
+            std::fputs(";\n", mFile);
+            return id;
+        }
+
+        std::size_t add(const char* entity)
+        {
+            const std::size_t id = ++mLastId;
+            std::fprintf(mFile, "#%zu=%s;\n", id, entity);
+            return id;
+        }
+
+    private:
+        std::FILE* mFile;
+        std::size_t mLastId = 0;
+    };
+}
+
+bool SyntheticIfcGenerator::write(const std::string& filename) const
+{
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(filename.c_str(), "w"), &std::fclose);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::fputs("ISO-10303-21;\nHEADER;\n"
+        "FILE_DESCRIPTION(('ViewDefinition [ReferenceView]'),'2;1');\n"
+        "FILE_NAME('synthetic.ifc','2024-01-01T00:00:00',(''),(''),'ifc2brep','ifc2brep','');\n"
+        "FILE_SCHEMA(('IFC4'));\nENDSEC;\nDATA;\n", file.get());
+
+    StepWriter step(file.get());
+    std::size_t seq = 0;
+
+    const std::size_t origin = step.add("IFCCARTESIANPOINT((0.,0.,0.))");
+    const std::size_t zAxis = step.add("IFCDIRECTION((0.,0.,1.))");
+    const std::size_t xAxis = step.add("IFCDIRECTION((1.,0.,0.))");
+    const std::size_t worldPlacement = step.add("IFCAXIS2PLACEMENT3D(#%zu,#%zu,#%zu)", origin, zAxis, xAxis);
+    const std::size_t context = step.add("IFCGEOMETRICREPRESENTATIONCONTEXT($,'Model',3,1.E-05,#%zu,$)", worldPlacement);
+    const std::size_t unit = step.add("IFCSIUNIT(*,.LENGTHUNIT.,$,.METRE.)");
+    const std::size_t units = step.add("IFCUNITASSIGNMENT((#%zu))", unit);
+    step.add("IFCPROJECT('%s',$,'Synthetic',$,$,$,$,(#%zu),#%zu)", globalId(seq++).c_str(), context, units);
+    const std::size_t origin2d = step.add("IFCCARTESIANPOINT((0.,0.))");
+    const std::size_t xAxis2d = step.add("IFCDIRECTION((1.,0.))");
+    const std::size_t profilePlacement = step.add("IFCAXIS2PLACEMENT2D(#%zu,#%zu)", origin2d, xAxis2d);
+
+    std::vector<std::size_t> maps;
+    for (std::size_t mapIdx = 0; mapIdx < mParams.mapCount; ++mapIdx)
+    {
+        std::vector<std::size_t> items;
+
+        if (mParams.surfaceTriangles > 0)
+        {
+            // Triangle strip over a 1 x n grid, the map index varies the height so the maps differ
+            const double z = 0.1 * static_cast<double>(mapIdx);
+            std::vector<std::size_t> faces;
+            for (std::size_t tri = 0; tri < mParams.surfaceTriangles; ++tri)
+            {
+                const double x = 0.5 * static_cast<double>(tri / 2);
+                const bool upper = (tri % 2) != 0;
+                const std::size_t p0 = step.add("IFCCARTESIANPOINT((%.6f,%.6f,%.6f))", upper ? x + 0.5 : x, upper ? 1.0 : 0.0, z);
+                const std::size_t p1 = step.add("IFCCARTESIANPOINT((%.6f,%.6f,%.6f))", upper ? x : x + 0.5, upper ? 1.0 : 0.0, z);
+                const std::size_t p2 = step.add("IFCCARTESIANPOINT((%.6f,%.6f,%.6f))", upper ? x + 0.5 : x, upper ? 0.0 : 1.0, z);
+                const std::size_t loop = step.add("IFCPOLYLOOP((#%zu,#%zu,#%zu))", p0, p1, p2);
+                const std::size_t bound = step.add("IFCFACEOUTERBOUND(#%zu,.T.)", loop);
+                faces.push_back(step.add("IFCFACE((#%zu))", bound));
+            }
+            std::string faceList;
+            for (std::size_t face : faces)
+            {
+                faceList += faceList.empty() ? "#" : ",#";
+                faceList += std::to_string(face);
+            }
+            const std::size_t shell = step.add("IFCOPENSHELL((%s))", faceList.c_str());
+            items.push_back(step.add("IFCSHELLBASEDSURFACEMODEL((#%zu))", shell));
+        }
+
+        for (std::size_t cylinderIdx = 0; cylinderIdx < mParams.cylinderCount; ++cylinderIdx)
+        {
+            const double radius = 0.05 + 0.01 * static_cast<double>(mapIdx % 5);
+            const std::size_t profile = step.add("IFCCIRCLEPROFILEDEF(.AREA.,$,#%zu,%.6f)", profilePlacement, radius);
+            const std::size_t location = step.add("IFCCARTESIANPOINT((%.6f,-0.5,0.))", 0.5 * static_cast<double>(cylinderIdx));
+            const std::size_t placement = step.add("IFCAXIS2PLACEMENT3D(#%zu,#%zu,#%zu)", location, zAxis, xAxis);
+            items.push_back(step.add("IFCEXTRUDEDAREASOLID(#%zu,#%zu,#%zu,%.6f)", profile, placement, zAxis, 3.0));
+        }
+
+        std::string itemList;
+        for (std::size_t item : items)
+        {
+            itemList += itemList.empty() ? "#" : ",#";
+            itemList += std::to_string(item);
+        }
+        const std::size_t representation = step.add("IFCSHAPEREPRESENTATION(#%zu,'Body','SurfaceModel',(%s))", context, itemList.c_str());
+        maps.push_back(step.add("IFCREPRESENTATIONMAP(#%zu,#%zu)", worldPlacement, representation));
+    }
+
+    // Products on a square grid, 2 m apart
+    std::size_t gridSize = 1;
+    while (gridSize * gridSize < mParams.productCount)
+    {
+        ++gridSize;
+    }
+    for (std::size_t productIdx = 0; productIdx < mParams.productCount; ++productIdx)
+    {
+        const std::size_t localOrigin = step.add("IFCCARTESIANPOINT((%.1f,%.1f,0.))", 2.0 * static_cast<double>(productIdx % gridSize), 2.0 * static_cast<double>(productIdx / gridSize));
+        const std::size_t mappingTarget = step.add("IFCCARTESIANTRANSFORMATIONOPERATOR3D($,$,#%zu,$,$)", localOrigin);
+        std::size_t shapeRepresentation = 0;
+        if (!maps.empty())
+        {
+            const std::size_t mappedItem = step.add("IFCMAPPEDITEM(#%zu,#%zu)", maps[productIdx % maps.size()], mappingTarget);
+            shapeRepresentation = step.add("IFCSHAPEREPRESENTATION(#%zu,'Body','MappedRepresentation',(#%zu))", context, mappedItem);
+        }
+        const std::size_t productShape = maps.empty() ? 0 : step.add("IFCPRODUCTDEFINITIONSHAPE($,$,(#%zu))", shapeRepresentation);
+        const std::size_t placement = step.add("IFCLOCALPLACEMENT($,#%zu)", worldPlacement);
+        if (productShape != 0)
+        {
+            step.add("IFCBUILDINGELEMENTPROXY('%s',$,'Proxy %zu',$,$,#%zu,#%zu,$,$)", globalId(seq++).c_str(), productIdx, placement, productShape);
+        }
+        else
+        {
+            step.add("IFCBUILDINGELEMENTPROXY('%s',$,'Proxy %zu',$,$,#%zu,$,$,$)", globalId(seq++).c_str(), productIdx, placement);
+        }
+    }
+
+    std::fputs("ENDSEC;\nEND-ISO-10303-21;\n", file.get());
+    return std::ferror(file.get()) == 0;
+}
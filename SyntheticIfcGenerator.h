@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Writes IFC4 STEP files with a known amount of geometry for the benchmarks.
+// Every product is an IfcBuildingElementProxy with one IfcMappedItem; the products cycle through mapCount shared
+// IfcRepresentationMaps. Each map holds an IfcShellBasedSurfaceModel of surfaceTriangles triangles (every triangle
+// with its own points, as exporters write them) and cylinderCount circular IfcExtrudedAreaSolids.
+class SyntheticIfcGenerator
+{
+public:
+    struct Params
+    {
+        std::size_t productCount = 1000;
+        std::size_t mapCount = 10;
+        std::size_t surfaceTriangles = 200;
+        std::size_t cylinderCount = 4;
+    };
+
+    explicit SyntheticIfcGenerator(const Params& params) : mParams(params) {}
+
+    // Returns false if the file can't be written
+    bool write(const std::string& filename) const;
+
+private:
+    Params mParams;
+};
@@ -0,0 +1,104 @@
+#include "TriangleCapture.h"
+
+void TriangleCapture::beginProduct(OdUInt64 handle)
+{
+    mProducts.push_back({ handle, mVertices.size(), 0, mIndices.size(), 0 });
+    mInProduct = true;
+}
+
+void TriangleCapture::endProduct()
+{
+    if (!mInProduct)
+    {
+        return;
+    }
+    mInProduct = false;
+
+    Product& product = mProducts.back();
+    product.vertexCount = mVertices.size() - product.firstVertex;
+    product.indexCount = mIndices.size() - product.firstIndex;
+    if (product.indexCount == 0)
+    {
+        mVertices.resize(product.firstVertex);
+        mProducts.pop_back();
+    }
+}
+
+std::uint32_t TriangleCapture::appendVertex(const OdGePoint3d& pt)
+{
+    mVertices.push_back(pt);
+    return static_cast<std::uint32_t>(mVertices.size() - 1 - mProducts.back().firstVertex);
+}
+
+void TriangleCapture::appendTriangle(std::uint32_t v0, std::uint32_t v1, std::uint32_t v2)
+{
+    mIndices.push_back(v0);
+    mIndices.push_back(v1);
+    mIndices.push_back(v2);
+}
+
+void TriangleCapture::appendProduct(const TriangleCapture& other, std::size_t productIdx)
+{
+    const Product& product = other.mProducts[productIdx];
+    mProducts.push_back({ product.handle, mVertices.size(), product.vertexCount, mIndices.size(), product.indexCount });
+    mVertices.insert(mVertices.end(), other.mVertices.begin() + product.firstVertex, other.mVertices.begin() + product.firstVertex + product.vertexCount);
+    mIndices.insert(mIndices.end(), other.mIndices.begin() + product.firstIndex, other.mIndices.begin() + product.firstIndex + product.indexCount);
+}
+
+void TriangleCaptureGeometry::shellProc(OdInt32 numVertices, const OdGePoint3d* vertexList, OdInt32 faceListSize, const OdInt32* faceList,
+    const OdGiEdgeData* pEdgeData, const OdGiFaceData* pFaceData, const OdGiVertexData* pVertexData)
+{
+    resetVertexMap();
+    OdGiGeometrySimplifier::shellProc(numVertices, vertexList, faceListSize, faceList, pEdgeData, pFaceData, pVertexData);
+}
+
+void TriangleCaptureGeometry::meshProc(OdInt32 numRows, OdInt32 numColumns, const OdGePoint3d* vertexList,
+    const OdGiEdgeData* pEdgeData, const OdGiFaceData* pFaceData, const OdGiVertexData* pVertexData)
+{
+    resetVertexMap();
+    OdGiGeometrySimplifier::meshProc(numRows, numColumns, vertexList, pEdgeData, pFaceData, pVertexData);
+}
+
+void TriangleCaptureGeometry::polygonProc(OdInt32 numVertices, const OdGePoint3d* vertexList, const OdGeVector3d* pNormal, const OdGeVector3d* pExtrusion)
+{
+    resetVertexMap();
+    OdGiGeometrySimplifier::polygonProc(numVertices, vertexList, pNormal, pExtrusion);
+}
+
+void TriangleCaptureGeometry::resetVertexMap()
+{
+    mVertexList = nullptr;
+    mVertexMap.clear();
+}
+
+void TriangleCaptureGeometry::triangleOut(const OdInt32* p3Vertices, const OdGeVector3d* /*pNormal*/)
+{
+    if (!mCapture.inProduct())
+    {
+        return;
+    }
+
+    // The vertices of a shell are shared by its triangles, each one is transformed and appended once
+    const OdGePoint3d* vertexList = vertexDataList();
+    if (vertexList != mVertexList || static_cast<std::size_t>(vertexDataCount()) > mVertexMap.size())
+    {
+        if (vertexList != mVertexList)
+        {
+            mVertexMap.clear();
+        }
+        mVertexList = vertexList;
+        mVertexMap.resize(static_cast<std::size_t>(vertexDataCount()), kUnmapped);
+    }
+
+    std::uint32_t indices[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        std::uint32_t& mapped = mVertexMap[static_cast<std::size_t>(p3Vertices[i])];
+        if (mapped == kUnmapped)
+        {
+            mapped = mCapture.appendVertex(mOutputToWorld * vertexList[p3Vertices[i]]);
+        }
+        indices[i] = mapped;
+    }
+    mCapture.appendTriangle(indices[0], indices[1], indices[2]);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "OdaCommon.h"
+
+#include "Ge/GePoint3d.h"
+#include "Ge/GeMatrix3d.h"
+#include "Gi/GiGeometrySimplifier.h"
+
+#include <cstdint>
+#include <vector>
+
+// World space triangles of the vectorized products, in flat buffers. Every product owns a contiguous range of the
+// vertex and the index buffer, its indices are relative to its first vertex.
+class TriangleCapture
+{
+public:
+    struct Product
+    {
+        OdUInt64 handle;
+        std::size_t firstVertex;
+        std::size_t vertexCount;
+        std::size_t firstIndex;
+        std::size_t indexCount;
+    };
+
+    // Triangles outside of a product are dropped, products without triangles aren't kept
+    void beginProduct(OdUInt64 handle);
+    void endProduct();
+    bool inProduct() const { return mInProduct; }
+
+    // Index of the vertex relative to the first vertex of the current product
+    std::uint32_t appendVertex(const OdGePoint3d& pt);
+    void appendTriangle(std::uint32_t v0, std::uint32_t v1, std::uint32_t v2);
+
+    // Appends a product of another capture, its indices stay valid as they are relative to the product
+    void appendProduct(const TriangleCapture& other, std::size_t productIdx);
+
+    const std::vector<Product>& products() const { return mProducts; }
+    const std::vector<OdGePoint3d>& vertices() const { return mVertices; }
+    const std::vector<std::uint32_t>& indices() const { return mIndices; }
+    std::size_t triangleCount() const { return mIndices.size() / 3; }
+
+private:
+    std::vector<OdGePoint3d> mVertices;
+    std::vector<std::uint32_t> mIndices;
+    std::vector<Product> mProducts;
+    bool mInProduct = false;
+};
+
+// Conveyor end point that receives the tessellated shells, meshes and filled polygons as triangles and appends them
+// to a TriangleCapture in world space. Lines and text are dropped.
+class TriangleCaptureGeometry : public OdGiGeometrySimplifier
+{
+public:
+    explicit TriangleCaptureGeometry(TriangleCapture& capture) : mCapture(capture) {}
+
+    // Inverse of the output transform of the view
+    void setOutputToWorld(const OdGeMatrix3d& outputToWorld) { mOutputToWorld = outputToWorld; }
+
+    void shellProc(OdInt32 numVertices, const OdGePoint3d* vertexList, OdInt32 faceListSize, const OdInt32* faceList,
+        const OdGiEdgeData* pEdgeData = 0, const OdGiFaceData* pFaceData = 0, const OdGiVertexData* pVertexData = 0) override;
+    void meshProc(OdInt32 numRows, OdInt32 numColumns, const OdGePoint3d* vertexList,
+        const OdGiEdgeData* pEdgeData = 0, const OdGiFaceData* pFaceData = 0, const OdGiVertexData* pVertexData = 0) override;
+    void polygonProc(OdInt32 numVertices, const OdGePoint3d* vertexList, const OdGeVector3d* pNormal = 0, const OdGeVector3d* pExtrusion = 0) override;
+
+protected:
+    void triangleOut(const OdInt32* p3Vertices, const OdGeVector3d* pNormal) override;
+    void polylineOut(OdInt32 /*numPoints*/, const OdGePoint3d* /*vertexList*/) override {}
+
+private:
+    static const std::uint32_t kUnmapped = ~0u;
+
+    // Forgets the vertex mapping of the previous primitive
+    void resetVertexMap();
+
+    TriangleCapture& mCapture;
+    OdGeMatrix3d mOutputToWorld;
+    const OdGePoint3d* mVertexList = nullptr;
+    std::vector<std::uint32_t> mVertexMap;     // simplifier vertex index -> product vertex index
+};